@@ -0,0 +1,164 @@
+/*
+ * Measures lookup throughput of a tree that's built once and then only searched, for:
+ * - a RBTree (RBTree.h), searched with containsRBTree
+ * - the same RBTree, searched in batches with containsManyRBTree (tree_extensions/rb_queries.h)
+ * - FrozenRBTree (tree_extensions/rb_frozen.h), made of that tree
+ * - VebRBTree (tree_extensions/rb_veb.h), made of that tree
+ * - BTree (tree_extensions/b_tree.h) of the default fanout, holding the same items
+ *
+ * usage: benchmark_lookup [max items = 10000000] [lookups = 10000000]
+ * runs with 10^6 items, then 10 times as many up to the maximum (10^9 items need tens of gigabytes). Half of the
+ * looked up items are in the tree.
+ */
+#include "RBTree.h"
+#include "tree_extensions/b_tree.h"
+#include "tree_extensions/rb_frozen.h"
+#include "tree_extensions/rb_queries.h"
+#include "tree_extensions/rb_veb.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <vector>
+
+static int compareInts(const void *a, const void *b)
+{
+    int x = *(const int *) a, y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+static void noFree(void *)
+{
+}
+
+static volatile long long foundSink;
+
+// probes per containsManyRBTree call, like a batch of requests fanned in
+#define BATCH_SIZE (256)
+
+/**
+ * a read-only index of a RBTree, behind a uniform interface.
+ */
+struct Index
+{
+    const char *name;
+    std::function<void(RBTree *)> build;
+    std::function<bool(const int *)> contains;
+    std::function<void()> destroy;
+    /// if set, used instead of 'contains' for looking up a batch of probes
+    std::function<void(void **, size_t, int *)> containsMany = nullptr;
+};
+
+static std::vector<Index> makeIndices()
+{
+    static RBTree *live;
+    static FrozenRBTree *frozen;
+    static VebRBTree *veb;
+    static BTree *bTree;
+    return {
+            {"RBTree",
+                    [](RBTree *tree) { live = tree; },
+                    [](const int *item) { return containsRBTree(live, (void *) item) != 0; },
+                    []() {}},
+            {"containsManyRBTree",
+                    [](RBTree *tree) { live = tree; },
+                    nullptr,
+                    []() {},
+                    [](void **probes, size_t n, int *out) { containsManyRBTree(live, probes, n, out); }},
+            {"FrozenRBTree",
+                    [](RBTree *tree) { frozen = freezeRBTree(tree); },
+                    [](const int *item) { return containsFrozenRBTree(frozen, item) != 0; },
+                    []() { freeFrozenRBTree(frozen); }},
+            {"VebRBTree",
+                    [](RBTree *tree) { veb = exportVebRBTree(tree); },
+                    [](const int *item) { return containsVebRBTree(veb, item) != 0; },
+                    []() { freeVebRBTree(veb); }},
+            {"BTree",
+                    [](RBTree *tree) {
+                        bTree = newBTree(compareInts, nullptr, 0);
+                        forEachRBTree(tree, [](const void *item, void *args) {
+                            return addToBTree((BTree *) args, (void *) item);
+                        }, bTree);
+                    },
+                    [](const int *item) { return containsBTree(bTree, item) != 0; },
+                    []() { freeBTree(bTree); }},
+    };
+}
+
+int main(int argc, char *argv[])
+{
+    long long maxItems = argc > 1 ? std::atoll(argv[1]) : 10000000;
+    long long lookups = argc > 2 ? std::atoll(argv[2]) : 10000000;
+    if (maxItems < 1000000 || maxItems > 1000000000 || lookups <= 0)
+    {
+        std::fprintf(stderr, "usage: %s [max items, 10^6 to 10^9] [lookups]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    std::vector<Index> indices = makeIndices();
+    std::printf("%-12s", "items");
+    for (const Index &index: indices)
+    {
+        std::printf("%20s", index.name);
+    }
+    std::printf("    (million lookups per second)\n");
+    std::default_random_engine random {};
+    for (long long n = 1000000; n <= maxItems; n *= 10)
+    {
+        // the even numbers below 2n are in the tree, so probing [0, 2n) hits half the time
+        std::vector<int> items((size_t) n);
+        for (long long i = 0; i < n; i++)
+        {
+            items[i] = (int) (2 * i);
+        }
+        std::shuffle(items.begin(), items.end(), random);
+        RBTree *tree = newRBTree(compareInts, noFree);
+        for (int &item: items)
+        {
+            addToRBTree(tree, &item);
+        }
+        std::uniform_int_distribution<int> probeOf(0, (int) (2 * n - 1));
+        std::vector<int> probes((size_t) lookups);
+        std::vector<void *> probePointers;
+        for (int &probe: probes)
+        {
+            probe = probeOf(random);
+            probePointers.push_back(&probe);
+        }
+
+        std::printf("%-12lld", n);
+        for (const Index &index: indices)
+        {
+            index.build(tree);
+            long long found = 0;
+            auto start = std::chrono::steady_clock::now();
+            if (index.containsMany)
+            {
+                int out[BATCH_SIZE];
+                for (size_t first = 0; first < probePointers.size(); first += BATCH_SIZE)
+                {
+                    size_t count = std::min((size_t) BATCH_SIZE, probePointers.size() - first);
+                    index.containsMany(&probePointers[first], count, out);
+                    found += std::count(out, out + count, 1);
+                }
+            }
+            else
+            {
+                for (const int &probe: probes)
+                {
+                    found += index.contains(&probe);
+                }
+            }
+            std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+            index.destroy();
+            // using the result keeps the lookups from being optimized away
+            foundSink = found;
+            std::printf("%20.2f", (double) lookups / seconds.count() / 1e6);
+            std::fflush(stdout);
+        }
+        std::printf("\n");
+        freeRBTree(tree);
+    }
+    return EXIT_SUCCESS;
+}
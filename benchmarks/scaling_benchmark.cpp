@@ -0,0 +1,134 @@
+/*
+ * Measures how insertion throughput scales with the number of producer threads, for:
+ * - a RBTree (RBTree.h) behind a single mutex
+ * - ConcurrentRBTree (tree_extensions/rb_concurrent.h)
+ * - SkipList (tree_extensions/skip_list.h)
+ *
+ * usage: benchmark_scaling [max threads = 64] [items per thread = 100000] [lookups per insertion = 0]
+ * every thread adds its own items (in random order), and between insertions looks up random items of its own.
+ */
+#include "RBTree.h"
+#include "tree_extensions/rb_concurrent.h"
+#include "tree_extensions/skip_list.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+static int compareInts(const void *a, const void *b)
+{
+    int x = *(const int *) a, y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+static void noFree(void *)
+{
+}
+
+/**
+ * the operations of one ordered set, behind a uniform interface.
+ */
+struct Backend
+{
+    const char *name;
+    std::function<void()> create;
+    std::function<void(int *)> add;
+    std::function<bool(const int *)> contains;
+    std::function<void()> destroy;
+};
+
+static std::vector<Backend> makeBackends()
+{
+    static RBTree *tree;
+    static std::mutex treeLock;
+    static ConcurrentRBTree *concurrent;
+    static SkipList *list;
+    return {
+            {"mutex + RBTree",
+                    []() { tree = newRBTree(compareInts, noFree); },
+                    [](int *item) {
+                        std::lock_guard<std::mutex> guard(treeLock);
+                        addToRBTree(tree, item);
+                    },
+                    [](const int *item) {
+                        std::lock_guard<std::mutex> guard(treeLock);
+                        return containsRBTree(tree, (void *) item) != 0;
+                    },
+                    []() { freeRBTree(tree); }},
+            {"ConcurrentRBTree",
+                    []() { concurrent = newConcurrentRBTree(compareInts, nullptr); },
+                    [](int *item) { addToConcurrentRBTree(concurrent, item); },
+                    [](const int *item) { return containsConcurrentRBTree(concurrent, item) != 0; },
+                    []() { freeConcurrentRBTree(concurrent); }},
+            {"SkipList",
+                    []() { list = newSkipList(compareInts, nullptr); },
+                    [](int *item) { addToSkipList(list, item); },
+                    [](const int *item) { return containsSkipList(list, item) != 0; },
+                    []() { freeSkipList(list); }},
+    };
+}
+
+int main(int argc, char *argv[])
+{
+    int maxThreads = argc > 1 ? std::atoi(argv[1]) : 64;
+    int perThread = argc > 2 ? std::atoi(argv[2]) : 100000;
+    int lookups = argc > 3 ? std::atoi(argv[3]) : 0;
+    if (maxThreads <= 0 || perThread <= 0 || lookups < 0)
+    {
+        std::fprintf(stderr, "usage: %s [max threads] [items per thread] [lookups per insertion]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    std::vector<int> items((size_t) maxThreads * perThread);
+    std::iota(items.begin(), items.end(), 0);
+    std::shuffle(items.begin(), items.end(), std::default_random_engine {});
+
+    std::vector<Backend> backends = makeBackends();
+    std::printf("%-8s", "threads");
+    for (const Backend &backend: backends)
+    {
+        std::printf("%20s", backend.name);
+    }
+    std::printf("    (million operations per second)\n");
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        std::printf("%-8d", threads);
+        for (const Backend &backend: backends)
+        {
+            backend.create();
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> workers;
+            for (int t = 0; t < threads; t++)
+            {
+                workers.emplace_back([&, t]() {
+                    int *mine = &items[(size_t) t * perThread];
+                    std::minstd_rand random(t);
+                    for (int i = 0; i < perThread; i++)
+                    {
+                        backend.add(&mine[i]);
+                        for (int j = 0; j < lookups; j++)
+                        {
+                            backend.contains(&mine[random() % (i + 1)]);
+                        }
+                    }
+                });
+            }
+            for (std::thread &worker: workers)
+            {
+                worker.join();
+            }
+            std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+            backend.destroy();
+            double operations = (double) threads * perThread * (1 + lookups);
+            std::printf("%20.2f", operations / seconds.count() / 1e6);
+            std::fflush(stdout);
+        }
+        std::printf("\n");
+    }
+    return EXIT_SUCCESS;
+}
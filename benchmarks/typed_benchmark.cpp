@@ -0,0 +1,130 @@
+/*
+ * Measures what compile time typing saves on small keys, for:
+ * - a RBTree (RBTree.h) of int pointers, compared through a CompareFunc
+ * - rb::Tree<int> (tree_extensions/rb_tree.hpp), holding the ints themselves
+ * - IntRBTree (tree_extensions/rb_define.h), the C equivalent
+ * - std::set<int>, for reference
+ *
+ * usage: benchmark_typed [items = 1000000] [lookups = 10000000]
+ * adds the items in random order, then looks up random items, half of which are in the tree.
+ */
+#include "RBTree.h"
+#include "tree_extensions/rb_define.h"
+#include "tree_extensions/rb_tree.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <set>
+#include <vector>
+
+static int compareInts(const void *a, const void *b)
+{
+    int x = *(const int *) a, y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+static void noFree(void *)
+{
+}
+
+static volatile long long foundSink;
+
+/**
+ * an ordered set of ints, behind a uniform interface.
+ */
+struct Backend
+{
+    const char *name;
+    std::function<void()> create;
+    std::function<void(int *)> add;
+    std::function<bool(const int *)> contains;
+    std::function<void()> destroy;
+};
+
+static std::vector<Backend> makeBackends()
+{
+    static RBTree *tree;
+    static rb::Tree<int> *typed;
+    static IntRBTree *generated;
+    static std::set<int> *set;
+    return {
+            {"RBTree",
+                    []() { tree = newRBTree(compareInts, noFree); },
+                    [](int *item) { addToRBTree(tree, item); },
+                    [](const int *item) { return containsRBTree(tree, (void *) item) != 0; },
+                    []() { freeRBTree(tree); }},
+            {"rb::Tree<int>",
+                    []() { typed = new rb::Tree<int>(); },
+                    [](int *item) { typed->insert(*item); },
+                    [](const int *item) { return typed->contains(*item); },
+                    []() { delete typed; }},
+            {"IntRBTree",
+                    []() { generated = newIntRBTree(); },
+                    [](int *item) { addToIntRBTree(generated, *item); },
+                    [](const int *item) { return containsIntRBTree(generated, *item) != 0; },
+                    []() { freeIntRBTree(generated); }},
+            {"std::set<int>",
+                    []() { set = new std::set<int>(); },
+                    [](int *item) { set->insert(*item); },
+                    [](const int *item) { return set->count(*item) != 0; },
+                    []() { delete set; }},
+    };
+}
+
+static double millionsPerSecond(long long operations, std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    return (double) operations / seconds.count() / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+    long long n = argc > 1 ? std::atoll(argv[1]) : 1000000;
+    long long lookups = argc > 2 ? std::atoll(argv[2]) : 10000000;
+    if (n <= 0 || n > 1000000000 || lookups <= 0)
+    {
+        std::fprintf(stderr, "usage: %s [items] [lookups]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    // the even numbers below 2n are added, so probing [0, 2n) hits half the time
+    std::default_random_engine random {};
+    std::vector<int> items((size_t) n);
+    for (long long i = 0; i < n; i++)
+    {
+        items[i] = (int) (2 * i);
+    }
+    std::shuffle(items.begin(), items.end(), random);
+    std::uniform_int_distribution<int> probeOf(0, (int) (2 * n - 1));
+    std::vector<int> probes((size_t) lookups);
+    for (int &probe: probes)
+    {
+        probe = probeOf(random);
+    }
+
+    std::printf("%-20s%15s%15s    (million operations per second)\n", "", "insert", "lookup");
+    for (const Backend &backend: makeBackends())
+    {
+        backend.create();
+        auto start = std::chrono::steady_clock::now();
+        for (int &item: items)
+        {
+            backend.add(&item);
+        }
+        double inserts = millionsPerSecond(n, start);
+        long long found = 0;
+        start = std::chrono::steady_clock::now();
+        for (const int &probe: probes)
+        {
+            found += backend.contains(&probe);
+        }
+        double finds = millionsPerSecond(lookups, start);
+        // using the result keeps the lookups from being optimized away
+        foundSink = found;
+        backend.destroy();
+        std::printf("%-20s%15.2f%15.2f\n", backend.name, inserts, finds);
+    }
+    return EXIT_SUCCESS;
+}
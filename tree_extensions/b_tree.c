@@ -0,0 +1,292 @@
+#include "b_tree.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * a node of either kind. Whether it's a leaf follows from its depth, as all the leaves are at the bottom level.
+ */
+typedef struct BTreeNode
+{
+    int count;              // items of a leaf, keys of an internal node
+    struct BTreeNode *next; // leaves only: the next leaf in ascending order
+    // a leaf: its items. An internal node: fanout - 1 keys, then fanout children - where key i is the smallest item
+    // under child i + 1
+    void *slots[];
+} BTreeNode;
+
+struct BTree
+{
+    CompareFunc compFunc;
+    FreeFunc freeFunc;
+    int size;
+    int fanout;
+    int height; // levels, 0 when empty
+    BTreeNode *root;
+};
+
+static BTreeNode *childAt(const BTree *tree, const BTreeNode *node, int i)
+{
+    return (BTreeNode *) node->slots[tree->fanout - 1 + i];
+}
+
+static void setChild(const BTree *tree, BTreeNode *node, int i, BTreeNode *child)
+{
+    node->slots[tree->fanout - 1 + i] = child;
+}
+
+static BTreeNode *newNode(const BTree *tree, int isLeaf)
+{
+    int slots = isLeaf ? tree->fanout - 1 : 2 * tree->fanout - 1;
+    BTreeNode *node = (BTreeNode *) malloc(sizeof(BTreeNode) + slots * sizeof(void *));
+    if (node != NULL)
+    {
+        node->count = 0;
+        node->next = NULL;
+    }
+    return node;
+}
+
+/**
+ * binary search of a node's sorted items or keys.
+ * @param found: set to other than 0 if one of them is equal to 'data'.
+ * @return: the number of them smaller than 'data'.
+ */
+static int lowerBound(const BTree *tree, const BTreeNode *node, const void *data, int *found)
+{
+    int low = 0, high = node->count;
+    while (low < high)
+    {
+        int middle = low + (high - low) / 2;
+        if (tree->compFunc(data, node->slots[middle]) > 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    *found = low < node->count && tree->compFunc(data, node->slots[low]) == 0;
+    return low;
+}
+
+/**
+ * splits the full child i of 'parent' in two halves, and adds the second half as child i + 1.
+ * @return: 0 on failure (and nothing changed), other on success.
+ */
+static int splitChild(BTree *tree, BTreeNode *parent, int i, int childIsLeaf)
+{
+    BTreeNode *child = childAt(tree, parent, i);
+    BTreeNode *right = newNode(tree, childIsLeaf);
+    if (right == NULL)
+    {
+        return 0;
+    }
+    int middle = child->count / 2;
+    void *separator;
+    if (childIsLeaf)
+    {
+        // in a B+ tree the separator is only a copy of the right half's first item, which stays in the leaf
+        right->count = child->count - middle;
+        memcpy(right->slots, child->slots + middle, right->count * sizeof(void *));
+        separator = right->slots[0];
+        right->next = child->next;
+        child->next = right;
+    }
+    else
+    {
+        right->count = child->count - middle - 1;
+        memcpy(right->slots, child->slots + middle + 1, right->count * sizeof(void *));
+        for (int j = 0; j <= right->count; j++)
+        {
+            setChild(tree, right, j, childAt(tree, child, middle + 1 + j));
+        }
+        separator = child->slots[middle];
+    }
+    child->count = middle;
+    memmove(parent->slots + i + 1, parent->slots + i, (parent->count - i) * sizeof(void *));
+    parent->slots[i] = separator;
+    for (int j = parent->count; j > i; j--)
+    {
+        setChild(tree, parent, j + 1, childAt(tree, parent, j));
+    }
+    setChild(tree, parent, i + 1, right);
+    parent->count++;
+    return 1;
+}
+
+BTree *newBTree(CompareFunc compFunc, FreeFunc freeFunc, int fanout)
+{
+    if (fanout == 0)
+    {
+        fanout = B_TREE_DEFAULT_FANOUT;
+    }
+    if (compFunc == NULL || fanout < 4 || fanout > (INT_MAX - 1) / 2)
+    {
+        return NULL;
+    }
+    BTree *tree = (BTree *) malloc(sizeof(BTree));
+    if (tree == NULL)
+    {
+        return NULL;
+    }
+    tree->compFunc = compFunc;
+    tree->freeFunc = freeFunc;
+    tree->size = 0;
+    tree->fanout = fanout;
+    tree->height = 0;
+    tree->root = NULL;
+    return tree;
+}
+
+int addToBTree(BTree *tree, void *data)
+{
+    if (tree == NULL || data == NULL || tree->size == INT_MAX)
+    {
+        return 0;
+    }
+    if (tree->root == NULL)
+    {
+        if ((tree->root = newNode(tree, 1)) == NULL)
+        {
+            return 0;
+        }
+        tree->height = 1;
+    }
+    // full nodes are split on the way down, so there's always room for a separator coming up from below. Every split
+    // leaves a valid tree, so a failure half way through needs no undoing
+    if (tree->root->count == tree->fanout - 1)
+    {
+        BTreeNode *root = newNode(tree, 0);
+        if (root == NULL)
+        {
+            return 0;
+        }
+        setChild(tree, root, 0, tree->root);
+        if (!splitChild(tree, root, 0, tree->height == 1))
+        {
+            free(root);
+            return 0;
+        }
+        tree->root = root;
+        tree->height++;
+    }
+    BTreeNode *node = tree->root;
+    int found;
+    for (int level = tree->height - 1; level > 0; level--)
+    {
+        int i = lowerBound(tree, node, data, &found);
+        if (found)
+        {
+            return 0;
+        }
+        BTreeNode *child = childAt(tree, node, i);
+        if (child->count == tree->fanout - 1)
+        {
+            if (!splitChild(tree, node, i, level == 1))
+            {
+                return 0;
+            }
+            int cmp = tree->compFunc(data, node->slots[i]);
+            if (cmp == 0)
+            {
+                return 0;
+            }
+            child = childAt(tree, node, cmp < 0 ? i : i + 1);
+        }
+        node = child;
+    }
+    int i = lowerBound(tree, node, data, &found);
+    if (found)
+    {
+        return 0;
+    }
+    memmove(node->slots + i + 1, node->slots + i, (node->count - i) * sizeof(void *));
+    node->slots[i] = data;
+    node->count++;
+    tree->size++;
+    return 1;
+}
+
+int containsBTree(const BTree *tree, const void *data)
+{
+    if (tree == NULL || data == NULL || tree->root == NULL)
+    {
+        return 0;
+    }
+    const BTreeNode *node = tree->root;
+    int found;
+    for (int level = tree->height - 1; level > 0; level--)
+    {
+        int i = lowerBound(tree, node, data, &found);
+        if (found)
+        {
+            return 1;
+        }
+        node = childAt(tree, node, i);
+    }
+    lowerBound(tree, node, data, &found);
+    return found;
+}
+
+int forEachBTree(const BTree *tree, forEachFunc func, void *args)
+{
+    if (tree == NULL || func == NULL)
+    {
+        return 0;
+    }
+    const BTreeNode *leaf = tree->root;
+    for (int level = tree->height - 1; level > 0; level--)
+    {
+        leaf = childAt(tree, leaf, 0);
+    }
+    for (; leaf != NULL; leaf = leaf->next)
+    {
+        for (int i = 0; i < leaf->count; i++)
+        {
+            if (!func(leaf->slots[i], args))
+            {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+int sizeOfBTree(const BTree *tree)
+{
+    return tree != NULL ? tree->size : 0;
+}
+
+static void freeSubtree(BTree *tree, BTreeNode *node, int level)
+{
+    if (level > 0)
+    {
+        for (int i = 0; i <= node->count; i++)
+        {
+            freeSubtree(tree, childAt(tree, node, i), level - 1);
+        }
+    }
+    else if (tree->freeFunc != NULL)
+    {
+        for (int i = 0; i < node->count; i++)
+        {
+            tree->freeFunc(node->slots[i]);
+        }
+    }
+    free(node);
+}
+
+void freeBTree(BTree *tree)
+{
+    if (tree == NULL)
+    {
+        return;
+    }
+    if (tree->root != NULL)
+    {
+        freeSubtree(tree, tree->root, tree->height - 1);
+    }
+    free(tree);
+}
@@ -0,0 +1,72 @@
+#ifndef B_TREE_H
+#define B_TREE_H
+
+#include "RBTree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// the fanout newBTree picks when given 0
+#define B_TREE_DEFAULT_FANOUT (16)
+
+/**
+ * An ordered set with the same surface as RBTree.h, for large sets where a RBTree's ~2log(n) levels - a cache miss
+ * each - dominate lookups.
+ * it's a B+ tree: every node keeps up to 'fanout' - 1 keys next to each other, so a lookup touches only about
+ * log(n) / log(fanout) nodes. All the items are in the leaves, and the leaves are chained in ascending order, so
+ * forEachBTree is a sequential walk over contiguous arrays.
+ */
+typedef struct BTree BTree;
+
+/**
+ * constructs a new, empty B tree.
+ * @param compFunc: a function two compare two variables.
+ * @param freeFunc: a function to free a data item, may be NULL.
+ * @param fanout: the maximal number of children of a node, at least 4. 0 for B_TREE_DEFAULT_FANOUT.
+ * @return: the new tree, or NULL on failure.
+ */
+BTree *newBTree(CompareFunc compFunc, FreeFunc freeFunc, int fanout);
+
+/**
+ * add an item to the tree
+ * @param tree: the tree to add an item to.
+ * @param data: item to add to the tree.
+ * @return: 0 on failure, other on success. (if the item is already in the tree - failure).
+ */
+int addToBTree(BTree *tree, void *data);
+
+/**
+ * check whether the tree contains this item.
+ * @param tree: the tree to check an item in.
+ * @param data: item to check.
+ * @return: 0 if the item is not in the tree, other if it is.
+ */
+int containsBTree(const BTree *tree, const void *data);
+
+/**
+ * Activate a function on each item of the tree, in ascending order. if one of the activations of the function
+ * returns 0, the process stops.
+ * @param tree: the tree with all the items.
+ * @param func: the function to activate on all items.
+ * @param args: more optional arguments to the function (may be null if the given function support it).
+ * @return: 0 on failure, other on success.
+ */
+int forEachBTree(const BTree *tree, forEachFunc func, void *args);
+
+/**
+ * @return: number of items in the tree.
+ */
+int sizeOfBTree(const BTree *tree);
+
+/**
+ * free all memory of the data structure, calling its FreeFunc (if any) on every item.
+ * @param tree: the tree to free.
+ */
+void freeBTree(BTree *tree);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //B_TREE_H
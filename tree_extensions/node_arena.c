@@ -0,0 +1,244 @@
+// posix_memalign
+#define _POSIX_C_SOURCE 200112L
+
+#include "node_arena.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#define CACHE_LINE (64)
+// chunks are aligned to their own size, so the chunk of a node is found by masking its address
+#define CHUNK_BYTES ((size_t)64 * 1024)
+
+/**
+ * header placed at the start of every chunk, the node slots follow it
+ */
+typedef struct Chunk
+{
+    struct Chunk *prev, *next;               // list of all chunks
+    struct Chunk *prevPartial, *nextPartial; // list of chunks that have a free slot
+    void *freeList;                          // released slots of this chunk, linked through their first bytes
+    size_t live;                             // slots currently handed out
+    size_t bumped;                           // slots [bumped, slotsPerChunk) were never handed out
+} Chunk;
+
+#define HEADER_BYTES (((sizeof(Chunk) + CACHE_LINE - 1) / CACHE_LINE) * CACHE_LINE)
+
+struct NodeArena
+{
+    size_t slotSize;
+    size_t slotsPerChunk;
+    size_t maxIdleChunks;
+    size_t idleChunks;
+    size_t chunkCount;
+    size_t references;
+    Chunk *chunks;
+    Chunk *partial;
+};
+
+static Chunk *chunkOf(const void *node)
+{
+    return (Chunk *) ((uintptr_t) node & ~(uintptr_t) (CHUNK_BYTES - 1));
+}
+
+static char *slotAt(Chunk *chunk, size_t slotSize, size_t index)
+{
+    return (char *) chunk + HEADER_BYTES + index * slotSize;
+}
+
+static void pushPartial(NodeArena *arena, Chunk *chunk)
+{
+    chunk->prevPartial = NULL;
+    chunk->nextPartial = arena->partial;
+    if (arena->partial != NULL)
+    {
+        arena->partial->prevPartial = chunk;
+    }
+    arena->partial = chunk;
+}
+
+static void unlinkPartial(NodeArena *arena, Chunk *chunk)
+{
+    if (chunk->prevPartial != NULL)
+    {
+        chunk->prevPartial->nextPartial = chunk->nextPartial;
+    }
+    else
+    {
+        arena->partial = chunk->nextPartial;
+    }
+    if (chunk->nextPartial != NULL)
+    {
+        chunk->nextPartial->prevPartial = chunk->prevPartial;
+    }
+}
+
+static Chunk *newChunk(NodeArena *arena)
+{
+    void *memory = NULL;
+    if (posix_memalign(&memory, CHUNK_BYTES, CHUNK_BYTES) != 0)
+    {
+        return NULL;
+    }
+    Chunk *chunk = (Chunk *) memory;
+    chunk->freeList = NULL;
+    chunk->live = 0;
+    chunk->bumped = 0;
+    chunk->prev = NULL;
+    chunk->next = arena->chunks;
+    if (arena->chunks != NULL)
+    {
+        arena->chunks->prev = chunk;
+    }
+    arena->chunks = chunk;
+    pushPartial(arena, chunk);
+    arena->chunkCount++;
+    arena->idleChunks++;
+    return chunk;
+}
+
+/**
+ * returns an empty chunk to the OS
+ */
+static void destroyChunk(NodeArena *arena, Chunk *chunk)
+{
+    unlinkPartial(arena, chunk);
+    if (chunk->prev != NULL)
+    {
+        chunk->prev->next = chunk->next;
+    }
+    else
+    {
+        arena->chunks = chunk->next;
+    }
+    if (chunk->next != NULL)
+    {
+        chunk->next->prev = chunk->prev;
+    }
+    arena->chunkCount--;
+    arena->idleChunks--;
+    free(chunk);
+}
+
+NodeArena *newNodeArena(size_t nodeSize, size_t maxIdleChunks)
+{
+    if (nodeSize == 0 || nodeSize > CHUNK_BYTES - HEADER_BYTES)
+    {
+        return NULL;
+    }
+    NodeArena *arena = (NodeArena *) malloc(sizeof(NodeArena));
+    if (arena == NULL)
+    {
+        return NULL;
+    }
+    // keep every slot pointer-aligned, and large enough to hold the free list link
+    size_t slotSize = ((nodeSize + sizeof(void *) - 1) / sizeof(void *)) * sizeof(void *);
+    arena->slotSize = slotSize;
+    arena->slotsPerChunk = (CHUNK_BYTES - HEADER_BYTES) / slotSize;
+    arena->maxIdleChunks = maxIdleChunks;
+    arena->idleChunks = 0;
+    arena->chunkCount = 0;
+    arena->references = 1;
+    arena->chunks = NULL;
+    arena->partial = NULL;
+    return arena;
+}
+
+void *nodeArenaAlloc(NodeArena *arena)
+{
+    Chunk *chunk = arena->partial;
+    if (chunk == NULL && (chunk = newChunk(arena)) == NULL)
+    {
+        return NULL;
+    }
+    void *node;
+    if (chunk->freeList != NULL)
+    {
+        node = chunk->freeList;
+        chunk->freeList = *(void **) node;
+    }
+    else
+    {
+        node = slotAt(chunk, arena->slotSize, chunk->bumped++);
+    }
+    if (chunk->live++ == 0)
+    {
+        arena->idleChunks--;
+    }
+    if (chunk->live == arena->slotsPerChunk)
+    {
+        unlinkPartial(arena, chunk);
+    }
+    return node;
+}
+
+void nodeArenaRelease(NodeArena *arena, void *node)
+{
+    if (node == NULL)
+    {
+        return;
+    }
+    Chunk *chunk = chunkOf(node);
+    if (chunk->live == arena->slotsPerChunk)
+    {
+        pushPartial(arena, chunk);
+    }
+    *(void **) node = chunk->freeList;
+    chunk->freeList = node;
+    if (--chunk->live == 0)
+    {
+        arena->idleChunks++;
+        if (arena->idleChunks > arena->maxIdleChunks)
+        {
+            destroyChunk(arena, chunk);
+        }
+    }
+}
+
+void nodeArenaTrim(NodeArena *arena)
+{
+    Chunk *chunk = arena->chunks;
+    while (chunk != NULL)
+    {
+        Chunk *next = chunk->next;
+        if (chunk->live == 0)
+        {
+            destroyChunk(arena, chunk);
+        }
+        chunk = next;
+    }
+}
+
+size_t nodeArenaReservedBytes(const NodeArena *arena)
+{
+    return arena->chunkCount * CHUNK_BYTES;
+}
+
+NodeArena *nodeArenaRetain(NodeArena *arena)
+{
+    if (arena != NULL)
+    {
+        arena->references++;
+    }
+    return arena;
+}
+
+int nodeArenaIsShared(const NodeArena *arena)
+{
+    return arena->references > 1;
+}
+
+void freeNodeArena(NodeArena *arena)
+{
+    if (arena == NULL || --arena->references > 0)
+    {
+        return;
+    }
+    Chunk *chunk = arena->chunks;
+    while (chunk != NULL)
+    {
+        Chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(arena);
+}
@@ -0,0 +1,72 @@
+#ifndef NODE_ARENA_H
+#define NODE_ARENA_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Pass as 'maxIdleChunks' to never return empty chunks to the OS before the arena is freed
+#define NODE_ARENA_KEEP_ALL ((size_t)-1)
+
+/**
+ * A slab allocator for fixed size tree nodes.
+ * Memory is taken from the OS in large, cache-line aligned chunks, and nodes are carved out of them - so allocating
+ * a node is a couple of pointer operations, and freeing the whole arena costs one 'free' per chunk instead of one per
+ * node.
+ */
+typedef struct NodeArena NodeArena;
+
+/**
+ * creates a new, empty arena.
+ * @param nodeSize: size in bytes of every node handed out by the arena.
+ * @param maxIdleChunks: how many completely empty chunks are kept around for reuse. Once there are more than that,
+ * an empty chunk is returned to the OS immediately. (NODE_ARENA_KEEP_ALL to keep them all)
+ * @return: the new arena, or NULL on failure.
+ */
+NodeArena *newNodeArena(size_t nodeSize, size_t maxIdleChunks);
+
+/**
+ * @return: a pointer to 'nodeSize' uninitialized bytes, or NULL on failure.
+ */
+void *nodeArenaAlloc(NodeArena *arena);
+
+/**
+ * gives a node obtained by nodeArenaAlloc back to the arena.
+ */
+void nodeArenaRelease(NodeArena *arena, void *node);
+
+/**
+ * returns every chunk that holds no live node to the OS, regardless of 'maxIdleChunks'.
+ */
+void nodeArenaTrim(NodeArena *arena);
+
+/**
+ * @return: number of bytes currently taken from the OS by the arena.
+ */
+size_t nodeArenaReservedBytes(const NodeArena *arena);
+
+/**
+ * adds a reference to the arena, for sharing it between several owners (e.g the two trees a tree was split into).
+ * an arena isn't thread safe, so its owners must not use it concurrently.
+ * @return: the arena.
+ */
+NodeArena *nodeArenaRetain(NodeArena *arena);
+
+/**
+ * @return: other than 0 if the arena has more than one reference.
+ */
+int nodeArenaIsShared(const NodeArena *arena);
+
+/**
+ * drops a reference to the arena. Once there are none left, frees the arena and every chunk in it - nodes obtained
+ * from it are invalid afterwards.
+ */
+void freeNodeArena(NodeArena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //NODE_ARENA_H
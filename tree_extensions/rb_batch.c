@@ -0,0 +1,231 @@
+#include "rb_extensions.h"
+#include "rb_internal.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * stable merge sort of indices into 'items', by the items they point at.
+ * @return: 0 on failure, other on success.
+ */
+static int sortIndices(void **items, size_t *indices, size_t count, CompareFunc compFunc)
+{
+    if (count < 2)
+    {
+        return 1;
+    }
+    size_t *buffer = (size_t *) malloc(count * sizeof(size_t));
+    if (buffer == NULL)
+    {
+        return 0;
+    }
+    for (size_t width = 1; width < count; width *= 2)
+    {
+        for (size_t low = 0; low < count; low += 2 * width)
+        {
+            size_t middle = low + width < count ? low + width : count;
+            size_t high = low + 2 * width < count ? low + 2 * width : count;
+            size_t left = low, right = middle, out = low;
+            while (left < middle && right < high)
+            {
+                // taking from the left run on ties keeps equal items in input order
+                if (compFunc(items[indices[left]], items[indices[right]]) <= 0)
+                {
+                    buffer[out++] = indices[left++];
+                }
+                else
+                {
+                    buffer[out++] = indices[right++];
+                }
+            }
+            while (left < middle)
+            {
+                buffer[out++] = indices[left++];
+            }
+            while (right < high)
+            {
+                buffer[out++] = indices[right++];
+            }
+        }
+        memcpy(indices, buffer, count * sizeof(size_t));
+    }
+    free(buffer);
+    return 1;
+}
+
+static Node *nextNode(Node *node)
+{
+    if (node->right != NULL)
+    {
+        node = node->right;
+        while (node->left != NULL)
+        {
+            node = node->left;
+        }
+        return node;
+    }
+    while (node->parent != NULL && node == node->parent->right)
+    {
+        node = node->parent;
+    }
+    return node->parent;
+}
+
+/**
+ * inserts the sorted, distinct items one after the other, starting every search at the previously inserted node.
+ * @return: 0 on failure, other on success.
+ */
+static int insertWithFinger(RBTreeEx *tree, void **items, const size_t *sorted, size_t count, int *results)
+{
+    Node *finger = NULL;
+    for (size_t k = 0; k < count; k++)
+    {
+        void *item = items[sorted[k]];
+        Node *parent, **link;
+        Node *found = extFindFromHint(&tree->base, finger, item, &parent, &link);
+        if (found != NULL)
+        {
+            finger = found;
+            continue;
+        }
+        if ((finger = extLinkNewNode(tree, item, parent, link)) == NULL)
+        {
+            return 0;
+        }
+        if (results != NULL)
+        {
+            results[sorted[k]] = 1;
+        }
+    }
+    return 1;
+}
+
+/**
+ * merges the sorted, distinct items with an in-order walk of the tree, and relinks every node (the existing ones are
+ * reused, so they keep their items) as a perfectly balanced tree.
+ * @return: 0 on failure (the tree is left unchanged), other on success.
+ */
+static int mergeAndRebuild(RBTreeEx *tree, void **items, const size_t *sorted, size_t count, int *results)
+{
+    size_t total = (size_t) tree->base.size + count;
+    Node **merged = (Node **) malloc(total * sizeof(Node *));
+    size_t *added = (size_t *) malloc(count * sizeof(size_t));
+    size_t *slots = (size_t *) malloc(count * sizeof(size_t));
+    if (merged == NULL || ((added == NULL || slots == NULL) && count > 0))
+    {
+        free(merged);
+        free(added);
+        free(slots);
+        return 0;
+    }
+    Node *node = tree->base.root;
+    while (node != NULL && node->left != NULL)
+    {
+        node = node->left;
+    }
+    // the order of the result, leaving a slot for every item to be added
+    size_t length = 0, addedCount = 0, k = 0;
+    while (node != NULL || k < count)
+    {
+        int cmp = node == NULL ? 1 : k == count ? -1 : tree->base.compFunc(node->data, items[sorted[k]]);
+        if (cmp <= 0)
+        {
+            merged[length++] = node;
+            node = nextNode(node);
+            // an item equal to one of the tree's is a duplicate, and isn't added
+            k += cmp == 0;
+        }
+        else
+        {
+            slots[addedCount] = length++;
+            added[addedCount++] = sorted[k++];
+        }
+    }
+    // allocate every new node before touching the tree, so a failure leaves it as it was
+    for (size_t j = 0; j < addedCount; j++)
+    {
+        Node *newNode = extAllocNode(tree, items[added[j]]);
+        if (newNode == NULL)
+        {
+            while (j-- > 0)
+            {
+                extReleaseNode(tree, merged[slots[j]]);
+            }
+            free(merged);
+            free(added);
+            free(slots);
+            return 0;
+        }
+        newNode->data = items[added[j]];
+        merged[slots[j]] = newNode;
+        if (results != NULL)
+        {
+            results[added[j]] = 1;
+        }
+    }
+    extLinkBalanced(tree, NULL, merged, length, NULL, &tree->base.root, 0, extRedDepth(length));
+    tree->base.size = (int) length;
+    free(merged);
+    free(added);
+    free(slots);
+    return 1;
+}
+
+int addManyToRBTree(RBTreeEx *tree, void **items, size_t m, int *results)
+{
+    if (tree == NULL || (items == NULL && m > 0) || m > (size_t) (INT_MAX - tree->base.size))
+    {
+        return 0;
+    }
+    if (results != NULL)
+    {
+        for (size_t i = 0; i < m; i++)
+        {
+            results[i] = 0;
+        }
+    }
+    size_t *sorted = (size_t *) malloc(m * sizeof(size_t));
+    if (sorted == NULL)
+    {
+        return m == 0;
+    }
+    // NULL items are never added
+    size_t count = 0;
+    for (size_t i = 0; i < m; i++)
+    {
+        if (items[i] != NULL)
+        {
+            sorted[count++] = i;
+        }
+    }
+    if (!sortIndices(items, sorted, count, tree->base.compFunc))
+    {
+        free(sorted);
+        return 0;
+    }
+    // of equal items, only the first (in input order) may be added - like adding them one by one would do
+    size_t distinct = 0;
+    for (size_t k = 0; k < count; k++)
+    {
+        if (distinct == 0 || tree->base.compFunc(items[sorted[distinct - 1]], items[sorted[k]]) != 0)
+        {
+            sorted[distinct++] = sorted[k];
+        }
+    }
+    int success;
+    if (distinct == 0)
+    {
+        success = 1;
+    }
+    else if (distinct >= (size_t) tree->base.size)
+    {
+        // a batch at least as large as the tree is cheapest to merge in with one linear pass
+        success = mergeAndRebuild(tree, items, sorted, distinct, results);
+    }
+    else
+    {
+        success = insertWithFinger(tree, items, sorted, distinct, results);
+    }
+    free(sorted);
+    return success;
+}
@@ -0,0 +1,232 @@
+#include "rb_compact.h"
+#include <limits.h>
+#include <stdlib.h>
+
+static void replaceChild(CompactRBTree *tree, CompactNode *node, CompactNode *replacement)
+{
+    CompactNode *parent = COMPACT_PARENT(node);
+    if (parent == NULL)
+    {
+        tree->root = replacement;
+    }
+    else if (node == parent->left)
+    {
+        parent->left = replacement;
+    }
+    else
+    {
+        parent->right = replacement;
+    }
+}
+
+static void rotateLeft(CompactRBTree *tree, CompactNode *node)
+{
+    CompactNode *pivot = node->right;
+    node->right = pivot->left;
+    if (pivot->left != NULL)
+    {
+        COMPACT_SET_PARENT(pivot->left, node);
+    }
+    COMPACT_SET_PARENT(pivot, COMPACT_PARENT(node));
+    replaceChild(tree, node, pivot);
+    pivot->left = node;
+    COMPACT_SET_PARENT(node, pivot);
+}
+
+static void rotateRight(CompactRBTree *tree, CompactNode *node)
+{
+    CompactNode *pivot = node->left;
+    node->left = pivot->right;
+    if (pivot->right != NULL)
+    {
+        COMPACT_SET_PARENT(pivot->right, node);
+    }
+    COMPACT_SET_PARENT(pivot, COMPACT_PARENT(node));
+    replaceChild(tree, node, pivot);
+    pivot->right = node;
+    COMPACT_SET_PARENT(node, pivot);
+}
+
+static int isRed(const CompactNode *node)
+{
+    return node != NULL && COMPACT_COLOR(node) == RED;
+}
+
+static void fixAfterInsert(CompactRBTree *tree, CompactNode *node)
+{
+    CompactNode *parent;
+    while ((parent = COMPACT_PARENT(node)) != NULL && isRed(parent))
+    {
+        CompactNode *grandparent = COMPACT_PARENT(parent);
+        int parentIsLeft = parent == grandparent->left;
+        CompactNode *uncle = parentIsLeft ? grandparent->right : grandparent->left;
+        if (isRed(uncle))
+        {
+            COMPACT_SET_COLOR(parent, BLACK);
+            COMPACT_SET_COLOR(uncle, BLACK);
+            COMPACT_SET_COLOR(grandparent, RED);
+            node = grandparent;
+            continue;
+        }
+        if (parentIsLeft)
+        {
+            if (node == parent->right)
+            {
+                rotateLeft(tree, parent);
+                parent = node;
+            }
+            rotateRight(tree, grandparent);
+        }
+        else
+        {
+            if (node == parent->left)
+            {
+                rotateRight(tree, parent);
+                parent = node;
+            }
+            rotateLeft(tree, grandparent);
+        }
+        COMPACT_SET_COLOR(parent, BLACK);
+        COMPACT_SET_COLOR(grandparent, RED);
+        break;
+    }
+    COMPACT_SET_COLOR(tree->root, BLACK);
+}
+
+CompactRBTree *newCompactRBTree(CompareFunc compFunc, FreeFunc freeFunc)
+{
+    if (compFunc == NULL)
+    {
+        return NULL;
+    }
+    CompactRBTree *tree = (CompactRBTree *) malloc(sizeof(CompactRBTree));
+    if (tree == NULL)
+    {
+        return NULL;
+    }
+    tree->arena = newNodeArena(sizeof(CompactNode), 1);
+    if (tree->arena == NULL)
+    {
+        free(tree);
+        return NULL;
+    }
+    tree->root = NULL;
+    tree->compFunc = compFunc;
+    tree->freeFunc = freeFunc;
+    tree->size = 0;
+    return tree;
+}
+
+int addToCompactRBTree(CompactRBTree *tree, void *data)
+{
+    if (tree == NULL || data == NULL || tree->size == INT_MAX)
+    {
+        return 0;
+    }
+    CompactNode *parent = NULL;
+    CompactNode **link = &tree->root;
+    while (*link != NULL)
+    {
+        int cmp = tree->compFunc(data, (*link)->data);
+        if (cmp == 0)
+        {
+            return 0;
+        }
+        parent = *link;
+        link = cmp < 0 ? &parent->left : &parent->right;
+    }
+    CompactNode *node = (CompactNode *) nodeArenaAlloc(tree->arena);
+    if (node == NULL)
+    {
+        return 0;
+    }
+    node->parentAndColor = 0;
+    COMPACT_SET_PARENT(node, parent);
+    COMPACT_SET_COLOR(node, RED);
+    node->left = NULL;
+    node->right = NULL;
+    node->data = data;
+    *link = node;
+    tree->size++;
+    fixAfterInsert(tree, node);
+    return 1;
+}
+
+int containsCompactRBTree(const CompactRBTree *tree, const void *data)
+{
+    if (tree == NULL || data == NULL)
+    {
+        return 0;
+    }
+    const CompactNode *node = tree->root;
+    while (node != NULL)
+    {
+        int cmp = tree->compFunc(data, node->data);
+        if (cmp == 0)
+        {
+            return 1;
+        }
+        node = cmp < 0 ? node->left : node->right;
+    }
+    return 0;
+}
+
+int forEachCompactRBTree(const CompactRBTree *tree, forEachFunc func, void *args)
+{
+    if (tree == NULL || func == NULL)
+    {
+        return 0;
+    }
+    const CompactNode *node = tree->root;
+    while (node != NULL && node->left != NULL)
+    {
+        node = node->left;
+    }
+    while (node != NULL)
+    {
+        if (!func(node->data, args))
+        {
+            return 0;
+        }
+        if (node->right != NULL)
+        {
+            node = node->right;
+            while (node->left != NULL)
+            {
+                node = node->left;
+            }
+        }
+        else
+        {
+            const CompactNode *parent = COMPACT_PARENT(node);
+            while (parent != NULL && node == parent->right)
+            {
+                node = parent;
+                parent = COMPACT_PARENT(node);
+            }
+            node = parent;
+        }
+    }
+    return 1;
+}
+
+static int freeItem(const void *data, void *args)
+{
+    (*(FreeFunc *) args)((void *) data);
+    return 1;
+}
+
+void freeCompactRBTree(CompactRBTree *tree)
+{
+    if (tree == NULL)
+    {
+        return;
+    }
+    // the nodes go away with the arena, only the items need visiting
+    if (tree->freeFunc != NULL)
+    {
+        forEachCompactRBTree(tree, freeItem, &tree->freeFunc);
+    }
+    freeNodeArena(tree->arena);
+    free(tree);
+}
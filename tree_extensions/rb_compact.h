@@ -0,0 +1,102 @@
+#ifndef RB_COMPACT_H
+#define RB_COMPACT_H
+
+#include <stdint.h>
+#include "RBTree.h"
+#include "node_arena.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * a 32 byte node (on 64 bit platforms), instead of the 40 bytes of Node.
+ * nodes are at least pointer aligned, so the lowest bit of a node's address is always 0 - and the color is kept in
+ * that bit of 'parentAndColor'. Access 'parentAndColor' only through the macros below.
+ */
+typedef struct CompactNode
+{
+    uintptr_t parentAndColor;
+    struct CompactNode *left, *right;
+    void *data;
+} CompactNode;
+
+#define COMPACT_PARENT(node) ((CompactNode *) ((node)->parentAndColor & ~(uintptr_t) 1))
+#define COMPACT_COLOR(node) (((node)->parentAndColor & 1) ? BLACK : RED)
+#define COMPACT_SET_PARENT(node, parent) \
+    ((node)->parentAndColor = (uintptr_t) (parent) | ((node)->parentAndColor & 1))
+#define COMPACT_SET_COLOR(node, color) \
+    ((node)->parentAndColor = ((node)->parentAndColor & ~(uintptr_t) 1) | (uintptr_t) ((color) == BLACK))
+
+/**
+ * a RBTree of CompactNodes. The nodes are carved out of a NodeArena, so (unlike with malloc) they don't carry an
+ * allocation header either - two nodes fit in a cache line.
+ * it mirrors RBTree, but as the nodes differ it can't be given to the functions of RBTree.h. The tree visualizer
+ * draws it like a RBTree.
+ */
+typedef struct CompactRBTree
+{
+    CompactNode *root;
+    CompareFunc compFunc;
+    FreeFunc freeFunc;
+    int size;
+    NodeArena *arena;
+} CompactRBTree;
+
+/**
+ * constructs a new compact RBTree with the given CompareFunc.
+ * @param compFunc: a function two compare two variables.
+ * @param freeFunc: a function to free a data item, may be NULL.
+ * @return: the new tree, or NULL on failure.
+ */
+CompactRBTree *newCompactRBTree(CompareFunc compFunc, FreeFunc freeFunc);
+
+/**
+ * add an item to the tree
+ * @param tree: the tree to add an item to.
+ * @param data: item to add to the tree.
+ * @return: 0 on failure, other on success. (if the item is already in the tree - failure).
+ */
+int addToCompactRBTree(CompactRBTree *tree, void *data);
+
+/**
+ * check whether the tree contains this item.
+ * @param tree: the tree to check an item in.
+ * @param data: item to check.
+ * @return: 0 if the item is not in the tree, other if it is.
+ */
+int containsCompactRBTree(const CompactRBTree *tree, const void *data);
+
+/**
+ * Activate a function on each item of the tree, in ascending order. if one of the activations of the function
+ * returns 0, the process stops.
+ * @param tree: the tree with all the items.
+ * @param func: the function to activate on all items.
+ * @param args: more optional arguments to the function (may be null if the given function support it).
+ * @return: 0 on failure, other on success.
+ */
+int forEachCompactRBTree(const CompactRBTree *tree, forEachFunc func, void *args);
+
+/**
+ * free all memory of the data structure, calling the tree's FreeFunc (if any) on every item.
+ * @param tree: the tree to free.
+ */
+void freeCompactRBTree(CompactRBTree *tree);
+
+#ifdef __cplusplus
+}
+
+// the tree visualizer (tree_visualizer/util.hpp) reads the parent and color of a node through these overloads, so it
+// draws compact trees like regular ones
+static inline const CompactNode *nodeParent(const CompactNode *node)
+{
+    return COMPACT_PARENT(node);
+}
+
+static inline Color nodeColor(const CompactNode *node)
+{
+    return COMPACT_COLOR(node);
+}
+#endif
+
+#endif //RB_COMPACT_H
@@ -0,0 +1,312 @@
+#include "rb_concurrent.h"
+#include "rb_internal.h"
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+// no valid search is longer than this (the height of a RB tree is at most 2log(n + 1)), a longer one must have
+// wandered into a rotation in progress
+#define MAX_SEARCH_STEPS (2 * 8 * sizeof(size_t))
+// optimistic searches to try before taking the lock
+#define OPTIMISTIC_ATTEMPTS (16)
+
+// the links readers follow (root, left, right) are only ever written through this. Releasing makes the (constant)
+// item of the node linked visible along with the link
+#define STORE_LINK(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELEASE)
+#define LOAD_LINK(field) __atomic_load_n(&(field), __ATOMIC_ACQUIRE)
+
+struct ConcurrentRBTree
+{
+    RBTreeEx *tree;       // nodes come from its arena, and it's used for freeing
+    pthread_mutex_t lock; // held by writers
+    size_t version;       // odd while a writer is restructuring the tree
+};
+
+/**
+ * marks the start of a change readers must not observe half way through. Call with the lock held.
+ */
+static void beginRestructure(ConcurrentRBTree *tree)
+{
+    __atomic_store_n(&tree->version, tree->version + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void endRestructure(ConcurrentRBTree *tree)
+{
+    __atomic_store_n(&tree->version, tree->version + 1, __ATOMIC_RELEASE);
+}
+
+static void replaceLink(RBTree *tree, Node *node, Node *replacement)
+{
+    if (node->parent == NULL)
+    {
+        STORE_LINK(tree->root, replacement);
+    }
+    else if (node == node->parent->left)
+    {
+        STORE_LINK(node->parent->left, replacement);
+    }
+    else
+    {
+        STORE_LINK(node->parent->right, replacement);
+    }
+}
+
+static void rotateLeft(RBTree *tree, Node *node)
+{
+    Node *pivot = node->right;
+    STORE_LINK(node->right, pivot->left);
+    if (pivot->left != NULL)
+    {
+        pivot->left->parent = node;
+    }
+    pivot->parent = node->parent;
+    replaceLink(tree, node, pivot);
+    STORE_LINK(pivot->left, node);
+    node->parent = pivot;
+}
+
+static void rotateRight(RBTree *tree, Node *node)
+{
+    Node *pivot = node->left;
+    STORE_LINK(node->left, pivot->right);
+    if (pivot->right != NULL)
+    {
+        pivot->right->parent = node;
+    }
+    pivot->parent = node->parent;
+    replaceLink(tree, node, pivot);
+    STORE_LINK(pivot->right, node);
+    node->parent = pivot;
+}
+
+/**
+ * the usual fixup after inserting a red leaf. Recoloring doesn't concern readers (they don't look at colors), so
+ * only the rotations are bracketed as a restructure.
+ */
+static void fixAfterInsert(ConcurrentRBTree *concurrent, Node *node)
+{
+    RBTree *tree = &concurrent->tree->base;
+    int restructuring = 0;
+    while (node->parent != NULL && node->parent->color == RED)
+    {
+        Node *parent = node->parent;
+        Node *grandparent = parent->parent;
+        int parentIsLeft = parent == grandparent->left;
+        Node *uncle = parentIsLeft ? grandparent->right : grandparent->left;
+        if (uncle != NULL && uncle->color == RED)
+        {
+            parent->color = BLACK;
+            uncle->color = BLACK;
+            grandparent->color = RED;
+            node = grandparent;
+            continue;
+        }
+        if (!restructuring)
+        {
+            beginRestructure(concurrent);
+            restructuring = 1;
+        }
+        if (parentIsLeft)
+        {
+            if (node == parent->right)
+            {
+                rotateLeft(tree, parent);
+                parent = node;
+            }
+            rotateRight(tree, grandparent);
+        }
+        else
+        {
+            if (node == parent->left)
+            {
+                rotateRight(tree, parent);
+                parent = node;
+            }
+            rotateLeft(tree, grandparent);
+        }
+        parent->color = BLACK;
+        grandparent->color = RED;
+        break;
+    }
+    tree->root->color = BLACK;
+    if (restructuring)
+    {
+        endRestructure(concurrent);
+    }
+}
+
+ConcurrentRBTree *newConcurrentRBTree(CompareFunc compFunc, FreeFunc freeFunc)
+{
+    if (compFunc == NULL)
+    {
+        return NULL;
+    }
+    ConcurrentRBTree *tree = (ConcurrentRBTree *) malloc(sizeof(ConcurrentRBTree));
+    if (tree == NULL)
+    {
+        return NULL;
+    }
+    // nodes are only freed along with the tree, so an arena is a natural fit
+    RBTreeConfig config = {1, NODE_ARENA_KEEP_ALL, 0, 0, 0};
+    tree->tree = newRBTreeEx(compFunc, freeFunc, &config);
+    if (tree->tree == NULL || pthread_mutex_init(&tree->lock, NULL) != 0)
+    {
+        freeRBTreeEx(tree->tree);
+        free(tree);
+        return NULL;
+    }
+    tree->version = 0;
+    return tree;
+}
+
+int addToConcurrentRBTree(ConcurrentRBTree *tree, void *data)
+{
+    if (tree == NULL || data == NULL)
+    {
+        return 0;
+    }
+    pthread_mutex_lock(&tree->lock);
+    RBTreeEx *base = tree->tree;
+    Node *parent, **link;
+    if (extFindFrom(&base->base, NULL, data, &parent, &link) != NULL || base->base.size == INT_MAX)
+    {
+        pthread_mutex_unlock(&tree->lock);
+        return 0;
+    }
+    Node *node = extAllocNode(base, data);
+    if (node == NULL)
+    {
+        pthread_mutex_unlock(&tree->lock);
+        return 0;
+    }
+    node->data = data;
+    node->left = NULL;
+    node->right = NULL;
+    node->parent = parent;
+    node->color = RED;
+    // publishing the initialized leaf is a single store, which readers either see or don't
+    STORE_LINK(*link, node);
+    base->base.size++;
+    fixAfterInsert(tree, node);
+    pthread_mutex_unlock(&tree->lock);
+    return 1;
+}
+
+/**
+ * searches the tree without synchronizing with writers.
+ * @return: 1 if 'data' was found, 0 if it wasn't, -1 if the search took too long to be valid.
+ */
+static int searchOptimistically(const RBTree *tree, const void *data)
+{
+    Node *node = LOAD_LINK(tree->root);
+    for (size_t steps = 0; node != NULL; steps++)
+    {
+        if (steps == MAX_SEARCH_STEPS)
+        {
+            return -1;
+        }
+        int cmp = tree->compFunc(data, node->data);
+        if (cmp == 0)
+        {
+            return 1;
+        }
+        node = cmp < 0 ? LOAD_LINK(node->left) : LOAD_LINK(node->right);
+    }
+    return 0;
+}
+
+int containsConcurrentRBTree(ConcurrentRBTree *tree, const void *data)
+{
+    if (tree == NULL || data == NULL)
+    {
+        return 0;
+    }
+    const RBTree *base = &tree->tree->base;
+    for (int attempt = 0; attempt < OPTIMISTIC_ATTEMPTS; attempt++)
+    {
+        size_t version = __atomic_load_n(&tree->version, __ATOMIC_ACQUIRE);
+        if (version % 2 != 0)
+        {
+            sched_yield();
+            continue;
+        }
+        int found = searchOptimistically(base, data);
+        // items are never removed, so an item that was found is in the tree - only a miss needs validating
+        if (found == 1)
+        {
+            return 1;
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (found == 0 && __atomic_load_n(&tree->version, __ATOMIC_RELAXED) == version)
+        {
+            return 0;
+        }
+    }
+    pthread_mutex_lock(&tree->lock);
+    Node *parent, **link;
+    int found = extFindFrom(base, NULL, data, &parent, &link) != NULL;
+    pthread_mutex_unlock(&tree->lock);
+    return found;
+}
+
+int forEachConcurrentRBTree(ConcurrentRBTree *tree, forEachFunc func, void *args)
+{
+    if (tree == NULL || func == NULL)
+    {
+        return 0;
+    }
+    pthread_mutex_lock(&tree->lock);
+    int success = 1;
+    Node *node = tree->tree->base.root;
+    while (node != NULL && node->left != NULL)
+    {
+        node = node->left;
+    }
+    while (node != NULL && success)
+    {
+        success = func(node->data, args) != 0;
+        if (node->right != NULL)
+        {
+            node = node->right;
+            while (node->left != NULL)
+            {
+                node = node->left;
+            }
+        }
+        else
+        {
+            while (node->parent != NULL && node == node->parent->right)
+            {
+                node = node->parent;
+            }
+            node = node->parent;
+        }
+    }
+    pthread_mutex_unlock(&tree->lock);
+    return success;
+}
+
+int sizeOfConcurrentRBTree(ConcurrentRBTree *tree)
+{
+    if (tree == NULL)
+    {
+        return 0;
+    }
+    pthread_mutex_lock(&tree->lock);
+    int size = tree->tree->base.size;
+    pthread_mutex_unlock(&tree->lock);
+    return size;
+}
+
+void freeConcurrentRBTree(ConcurrentRBTree *tree)
+{
+    if (tree == NULL)
+    {
+        return;
+    }
+    pthread_mutex_destroy(&tree->lock);
+    freeRBTreeEx(tree->tree);
+    free(tree);
+}
@@ -0,0 +1,69 @@
+#ifndef RB_CONCURRENT_H
+#define RB_CONCURRENT_H
+
+#include "RBTree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A RBTree that may be used by several threads at once.
+ * writers (adding, forEach) are serialized by a lock. Readers (containsConcurrentRBTree) never take it: they search
+ * the tree optimistically and validate the search with a version counter, which writers bump only around rotations -
+ * linking a new leaf is a single atomic store, so most insertions don't disturb readers at all. Items are never
+ * removed, so a reader can't run into a freed node.
+ */
+typedef struct ConcurrentRBTree ConcurrentRBTree;
+
+/**
+ * constructs a new concurrent RBTree with the given CompareFunc.
+ * @param compFunc: a function two compare two variables. Called from several threads at once.
+ * @param freeFunc: a function to free a data item, may be NULL.
+ * @return: the new tree, or NULL on failure.
+ */
+ConcurrentRBTree *newConcurrentRBTree(CompareFunc compFunc, FreeFunc freeFunc);
+
+/**
+ * add an item to the tree. Takes the writer lock.
+ * @param tree: the tree to add an item to.
+ * @param data: item to add to the tree.
+ * @return: 0 on failure, other on success. (if the item is already in the tree - failure).
+ */
+int addToConcurrentRBTree(ConcurrentRBTree *tree, void *data);
+
+/**
+ * check whether the tree contains this item, without taking a lock (unless writers keep getting in the way of the
+ * search, in which case it falls back to taking the writer lock).
+ * @param tree: the tree to check an item in.
+ * @param data: item to check.
+ * @return: 0 if the item is not in the tree, other if it is.
+ */
+int containsConcurrentRBTree(ConcurrentRBTree *tree, const void *data);
+
+/**
+ * Activate a function on each item of the tree, in ascending order. Holds the writer lock meanwhile, so the tree
+ * doesn't change during the walk (readers aren't blocked). 'func' mustn't add items to the tree.
+ * @param tree: the tree with all the items.
+ * @param func: the function to activate on all items.
+ * @param args: more optional arguments to the function (may be null if the given function support it).
+ * @return: 0 on failure, other on success.
+ */
+int forEachConcurrentRBTree(ConcurrentRBTree *tree, forEachFunc func, void *args);
+
+/**
+ * @return: number of items in the tree.
+ */
+int sizeOfConcurrentRBTree(ConcurrentRBTree *tree);
+
+/**
+ * free all memory of the data structure. No other thread may be using the tree.
+ * @param tree: the tree to free.
+ */
+void freeConcurrentRBTree(ConcurrentRBTree *tree);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RB_CONCURRENT_H
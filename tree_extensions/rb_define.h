@@ -0,0 +1,272 @@
+#ifndef RB_DEFINE_H
+#define RB_DEFINE_H
+
+#include <limits.h>
+#include <stdlib.h>
+#include "RBTree.h"
+
+/**
+ * RBTREE_DEFINE(name, key_type, cmp_expr) generates a RBTree specialised for one key type, for C code that can't use
+ * rb_tree.hpp: keys are stored by value inside the nodes, and 'cmp_expr' is compiled right into the search loop
+ * instead of being called through a CompareFunc.
+ * 'cmp_expr' compares two keys named 'a' and 'b' (of key_type), and like a CompareFunc evaluates to a negative
+ * number, 0 or a positive number. For example:
+ *
+ *     RBTREE_DEFINE(PointTree, Point, a.x != b.x ? RBTREE_COMPARE_NUMBERS(a.x, b.x) : RBTREE_COMPARE_NUMBERS(a.y, b.y))
+ *
+ * defines the types PointTree and PointTreeNode, and the functions (all static inline, so it may be used in headers):
+ * - PointTree *newPointTree(void): a new, empty tree - or NULL on failure.
+ * - int addToPointTree(PointTree *tree, Point key): 0 on failure, other on success (a key already in the tree fails).
+ * - int containsPointTree(const PointTree *tree, Point key): other than 0 if the key is in the tree.
+ * - int forEachPointTree(const PointTree *tree, int (*func)(const Point *key, void *args), void *args): activates
+ *   func on each key in ascending order, until it returns 0. 0 on failure, other on success.
+ * - void freePointTree(PointTree *tree)
+ * the tree's 'size' field holds the number of keys, and its nodes can be walked from 'root' like RBTree's.
+ */
+#define RBTREE_DEFINE(name, key_type, cmp_expr)                                                                       \
+    typedef struct name##Node                                                                                         \
+    {                                                                                                                 \
+        struct name##Node *parent, *left, *right;                                                                     \
+        Color color;                                                                                                  \
+        key_type key;                                                                                                 \
+    } name##Node;                                                                                                     \
+                                                                                                                      \
+    typedef struct name                                                                                               \
+    {                                                                                                                 \
+        name##Node *root;                                                                                             \
+        int size;                                                                                                     \
+    } name;                                                                                                           \
+                                                                                                                      \
+    static inline int name##Compare(key_type a, key_type b)                                                           \
+    {                                                                                                                 \
+        return (cmp_expr);                                                                                            \
+    }                                                                                                                 \
+                                                                                                                      \
+    static inline void name##ReplaceChild(name *tree, name##Node *node, name##Node *replacement)                      \
+    {                                                                                                                 \
+        if (node->parent == NULL)                                                                                     \
+        {                                                                                                             \
+            tree->root = replacement;                                                                                 \
+        }                                                                                                             \
+        else if (node == node->parent->left)                                                                          \
+        {                                                                                                             \
+            node->parent->left = replacement;                                                                         \
+        }                                                                                                             \
+        else                                                                                                          \
+        {                                                                                                             \
+            node->parent->right = replacement;                                                                        \
+        }                                                                                                             \
+    }                                                                                                                 \
+                                                                                                                      \
+    static inline void name##RotateLeft(name *tree, name##Node *node)                                                 \
+    {                                                                                                                 \
+        name##Node *pivot = node->right;                                                                              \
+        node->right = pivot->left;                                                                                    \
+        if (pivot->left != NULL)                                                                                      \
+        {                                                                                                             \
+            pivot->left->parent = node;                                                                               \
+        }                                                                                                             \
+        pivot->parent = node->parent;                                                                                 \
+        name##ReplaceChild(tree, node, pivot);                                                                        \
+        pivot->left = node;                                                                                           \
+        node->parent = pivot;                                                                                         \
+    }                                                                                                                 \
+                                                                                                                      \
+    static inline void name##RotateRight(name *tree, name##Node *node)                                                \
+    {                                                                                                                 \
+        name##Node *pivot = node->left;                                                                               \
+        node->left = pivot->right;                                                                                    \
+        if (pivot->right != NULL)                                                                                     \
+        {                                                                                                             \
+            pivot->right->parent = node;                                                                              \
+        }                                                                                                             \
+        pivot->parent = node->parent;                                                                                 \
+        name##ReplaceChild(tree, node, pivot);                                                                        \
+        pivot->right = node;                                                                                          \
+        node->parent = pivot;                                                                                         \
+    }                                                                                                                 \
+                                                                                                                      \
+    static inline void name##FixAfterInsert(name *tree, name##Node *node)                                             \
+    {                                                                                                                 \
+        name##Node *parent;                                                                                           \
+        while ((parent = node->parent) != NULL && parent->color == RED)                                               \
+        {                                                                                                             \
+            name##Node *grandparent = parent->parent;                                                                 \
+            int parentIsLeft = parent == grandparent->left;                                                           \
+            name##Node *uncle = parentIsLeft ? grandparent->right : grandparent->left;                                \
+            if (uncle != NULL && uncle->color == RED)                                                                 \
+            {                                                                                                         \
+                parent->color = BLACK;                                                                                \
+                uncle->color = BLACK;                                                                                 \
+                grandparent->color = RED;                                                                             \
+                node = grandparent;                                                                                   \
+                continue;                                                                                             \
+            }                                                                                                         \
+            if (parentIsLeft)                                                                                         \
+            {                                                                                                         \
+                if (node == parent->right)                                                                            \
+                {                                                                                                     \
+                    name##RotateLeft(tree, parent);                                                                   \
+                    parent = node;                                                                                    \
+                }                                                                                                     \
+                name##RotateRight(tree, grandparent);                                                                 \
+            }                                                                                                         \
+            else                                                                                                      \
+            {                                                                                                         \
+                if (node == parent->left)                                                                             \
+                {                                                                                                     \
+                    name##RotateRight(tree, parent);                                                                  \
+                    parent = node;                                                                                    \
+                }                                                                                                     \
+                name##RotateLeft(tree, grandparent);                                                                  \
+            }                                                                                                         \
+            parent->color = BLACK;                                                                                    \
+            grandparent->color = RED;                                                                                 \
+            break;                                                                                                    \
+        }                                                                                                             \
+        tree->root->color = BLACK;                                                                                    \
+    }                                                                                                                 \
+                                                                                                                      \
+    static inline name *new##name(void)                                                                               \
+    {                                                                                                                 \
+        name *tree = (name *) malloc(sizeof(name));                                                                   \
+        if (tree != NULL)                                                                                             \
+        {                                                                                                             \
+            tree->root = NULL;                                                                                        \
+            tree->size = 0;                                                                                           \
+        }                                                                                                             \
+        return tree;                                                                                                  \
+    }                                                                                                                 \
+                                                                                                                      \
+    static inline int addTo##name(name *tree, key_type key)                                                           \
+    {                                                                                                                 \
+        if (tree == NULL || tree->size == INT_MAX)                                                                    \
+        {                                                                                                             \
+            return 0;                                                                                                 \
+        }                                                                                                             \
+        name##Node *parent = NULL;                                                                                    \
+        name##Node **link = &tree->root;                                                                              \
+        while (*link != NULL)                                                                                         \
+        {                                                                                                             \
+            int cmp = name##Compare(key, (*link)->key);                                                               \
+            if (cmp == 0)                                                                                             \
+            {                                                                                                         \
+                return 0;                                                                                             \
+            }                                                                                                         \
+            parent = *link;                                                                                           \
+            link = cmp < 0 ? &parent->left : &parent->right;                                                          \
+        }                                                                                                             \
+        name##Node *node = (name##Node *) malloc(sizeof(name##Node));                                                 \
+        if (node == NULL)                                                                                             \
+        {                                                                                                             \
+            return 0;                                                                                                 \
+        }                                                                                                             \
+        node->parent = parent;                                                                                        \
+        node->left = NULL;                                                                                            \
+        node->right = NULL;                                                                                           \
+        node->color = RED;                                                                                            \
+        node->key = key;                                                                                              \
+        *link = node;                                                                                                 \
+        tree->size++;                                                                                                 \
+        name##FixAfterInsert(tree, node);                                                                             \
+        return 1;                                                                                                     \
+    }                                                                                                                 \
+                                                                                                                      \
+    static inline int contains##name(const name *tree, key_type key)                                                  \
+    {                                                                                                                 \
+        const name##Node *node = tree != NULL ? tree->root : NULL;                                                    \
+        while (node != NULL)                                                                                          \
+        {                                                                                                             \
+            int cmp = name##Compare(key, node->key);                                                                  \
+            if (cmp == 0)                                                                                             \
+            {                                                                                                         \
+                return 1;                                                                                             \
+            }                                                                                                         \
+            node = cmp < 0 ? node->left : node->right;                                                                \
+        }                                                                                                             \
+        return 0;                                                                                                     \
+    }                                                                                                                 \
+                                                                                                                      \
+    static inline int forEach##name(const name *tree, int (*func)(const key_type *key, void *args), void *args)       \
+    {                                                                                                                 \
+        if (tree == NULL || func == NULL)                                                                             \
+        {                                                                                                             \
+            return 0;                                                                                                 \
+        }                                                                                                             \
+        const name##Node *node = tree->root;                                                                          \
+        while (node != NULL && node->left != NULL)                                                                    \
+        {                                                                                                             \
+            node = node->left;                                                                                        \
+        }                                                                                                             \
+        while (node != NULL)                                                                                          \
+        {                                                                                                             \
+            if (!func(&node->key, args))                                                                              \
+            {                                                                                                         \
+                return 0;                                                                                             \
+            }                                                                                                         \
+            if (node->right != NULL)                                                                                  \
+            {                                                                                                         \
+                node = node->right;                                                                                   \
+                while (node->left != NULL)                                                                            \
+                {                                                                                                     \
+                    node = node->left;                                                                                \
+                }                                                                                                     \
+            }                                                                                                         \
+            else                                                                                                      \
+            {                                                                                                         \
+                while (node->parent != NULL && node == node->parent->right)                                           \
+                {                                                                                                     \
+                    node = node->parent;                                                                              \
+                }                                                                                                     \
+                node = node->parent;                                                                                  \
+            }                                                                                                         \
+        }                                                                                                             \
+        return 1;                                                                                                     \
+    }                                                                                                                 \
+                                                                                                                      \
+    static inline void free##name(name *tree)                                                                         \
+    {                                                                                                                 \
+        if (tree == NULL)                                                                                             \
+        {                                                                                                             \
+            return;                                                                                                   \
+        }                                                                                                             \
+        /* free the children before their parent, without recursion */                                               \
+        name##Node *node = tree->root;                                                                                \
+        while (node != NULL)                                                                                          \
+        {                                                                                                             \
+            if (node->left != NULL)                                                                                   \
+            {                                                                                                         \
+                node = node->left;                                                                                    \
+            }                                                                                                         \
+            else if (node->right != NULL)                                                                             \
+            {                                                                                                         \
+                node = node->right;                                                                                   \
+            }                                                                                                         \
+            else                                                                                                      \
+            {                                                                                                         \
+                name##Node *parent = node->parent;                                                                    \
+                if (parent != NULL && parent->left == node)                                                           \
+                {                                                                                                     \
+                    parent->left = NULL;                                                                              \
+                }                                                                                                     \
+                else if (parent != NULL)                                                                              \
+                {                                                                                                     \
+                    parent->right = NULL;                                                                             \
+                }                                                                                                     \
+                free(node);                                                                                           \
+                node = parent;                                                                                        \
+            }                                                                                                         \
+        }                                                                                                             \
+        free(tree);                                                                                                   \
+    }
+
+/// a cmp_expr for keys that are numbers, which (unlike a - b) never overflows
+#define RBTREE_COMPARE_NUMBERS(x, y) (((x) > (y)) - ((x) < (y)))
+
+/// IntRBTree: a tree of int keys
+RBTREE_DEFINE(IntRBTree, int, RBTREE_COMPARE_NUMBERS(a, b))
+
+/// DoubleRBTree: a tree of double keys. NaN compares equal to every key, so it must not be added
+RBTREE_DEFINE(DoubleRBTree, double, RBTREE_COMPARE_NUMBERS(a, b))
+
+#endif //RB_DEFINE_H
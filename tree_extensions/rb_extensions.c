@@ -0,0 +1,767 @@
+#include "rb_extensions.h"
+#include "rb_internal.h"
+#include <limits.h>
+#include <stdlib.h>
+
+static size_t nodeSize(int orderStatistics)
+{
+    return orderStatistics ? sizeof(CountedNode) : sizeof(Node);
+}
+
+Node *extAllocNode(RBTreeEx *tree, void *data)
+{
+    if (tree->intrusive)
+    {
+        return (Node *) ((char *) data + tree->hookOffset);
+    }
+    if (tree->arena != NULL)
+    {
+        return (Node *) nodeArenaAlloc(tree->arena);
+    }
+    return (Node *) malloc(nodeSize(tree->orderStatistics));
+}
+
+void extReleaseNode(RBTreeEx *tree, Node *node)
+{
+    // the hooks of an intrusive tree belong to its items
+    if (tree->intrusive)
+    {
+        return;
+    }
+    if (tree->arena != NULL)
+    {
+        nodeArenaRelease(tree->arena, node);
+    }
+    else
+    {
+        free(node);
+    }
+}
+
+static void rotateLeft(RBTreeEx *tree, Node *node)
+{
+    Node *pivot = node->right;
+    node->right = pivot->left;
+    if (pivot->left != NULL)
+    {
+        pivot->left->parent = node;
+    }
+    pivot->parent = node->parent;
+    if (node->parent == NULL)
+    {
+        tree->base.root = pivot;
+    }
+    else if (node == node->parent->left)
+    {
+        node->parent->left = pivot;
+    }
+    else
+    {
+        node->parent->right = pivot;
+    }
+    pivot->left = node;
+    node->parent = pivot;
+    if (tree->orderStatistics)
+    {
+        updateCount(node);
+        updateCount(pivot);
+    }
+}
+
+static void rotateRight(RBTreeEx *tree, Node *node)
+{
+    Node *pivot = node->left;
+    node->left = pivot->right;
+    if (pivot->right != NULL)
+    {
+        pivot->right->parent = node;
+    }
+    pivot->parent = node->parent;
+    if (node->parent == NULL)
+    {
+        tree->base.root = pivot;
+    }
+    else if (node == node->parent->right)
+    {
+        node->parent->right = pivot;
+    }
+    else
+    {
+        node->parent->left = pivot;
+    }
+    pivot->right = node;
+    node->parent = pivot;
+    if (tree->orderStatistics)
+    {
+        updateCount(node);
+        updateCount(pivot);
+    }
+}
+
+int extFixAfterInsert(RBTreeEx *tree, Node *node)
+{
+    while (node->parent != NULL && node->parent->color == RED)
+    {
+        Node *parent = node->parent;
+        Node *grandparent = parent->parent;
+        if (parent == grandparent->left)
+        {
+            Node *uncle = grandparent->right;
+            if (uncle != NULL && uncle->color == RED)
+            {
+                parent->color = BLACK;
+                uncle->color = BLACK;
+                grandparent->color = RED;
+                node = grandparent;
+                continue;
+            }
+            if (node == parent->right)
+            {
+                rotateLeft(tree, parent);
+                node = parent;
+                parent = node->parent;
+            }
+            parent->color = BLACK;
+            grandparent->color = RED;
+            rotateRight(tree, grandparent);
+        }
+        else
+        {
+            Node *uncle = grandparent->left;
+            if (uncle != NULL && uncle->color == RED)
+            {
+                parent->color = BLACK;
+                uncle->color = BLACK;
+                grandparent->color = RED;
+                node = grandparent;
+                continue;
+            }
+            if (node == parent->left)
+            {
+                rotateRight(tree, parent);
+                node = parent;
+                parent = node->parent;
+            }
+            parent->color = BLACK;
+            grandparent->color = RED;
+            rotateLeft(tree, grandparent);
+        }
+    }
+    int grew = tree->base.root->color == RED;
+    tree->base.root->color = BLACK;
+    return grew;
+}
+
+/**
+ * restores the RB properties after a black node was unlinked from 'parent', leaving 'node' (possibly NULL) one black
+ * node short
+ */
+static void fixAfterRemove(RBTreeEx *tree, Node *node, Node *parent)
+{
+    while (node != tree->base.root && (node == NULL || node->color == BLACK))
+    {
+        if (node == parent->left)
+        {
+            Node *sibling = parent->right;
+            if (sibling->color == RED)
+            {
+                sibling->color = BLACK;
+                parent->color = RED;
+                rotateLeft(tree, parent);
+                sibling = parent->right;
+            }
+            if ((sibling->left == NULL || sibling->left->color == BLACK) &&
+                (sibling->right == NULL || sibling->right->color == BLACK))
+            {
+                sibling->color = RED;
+                node = parent;
+                parent = node->parent;
+                continue;
+            }
+            if (sibling->right == NULL || sibling->right->color == BLACK)
+            {
+                sibling->left->color = BLACK;
+                sibling->color = RED;
+                rotateRight(tree, sibling);
+                sibling = parent->right;
+            }
+            sibling->color = parent->color;
+            parent->color = BLACK;
+            sibling->right->color = BLACK;
+            rotateLeft(tree, parent);
+            node = tree->base.root;
+        }
+        else
+        {
+            Node *sibling = parent->left;
+            if (sibling->color == RED)
+            {
+                sibling->color = BLACK;
+                parent->color = RED;
+                rotateRight(tree, parent);
+                sibling = parent->left;
+            }
+            if ((sibling->left == NULL || sibling->left->color == BLACK) &&
+                (sibling->right == NULL || sibling->right->color == BLACK))
+            {
+                sibling->color = RED;
+                node = parent;
+                parent = node->parent;
+                continue;
+            }
+            if (sibling->left == NULL || sibling->left->color == BLACK)
+            {
+                sibling->right->color = BLACK;
+                sibling->color = RED;
+                rotateLeft(tree, sibling);
+                sibling = parent->left;
+            }
+            sibling->color = parent->color;
+            parent->color = BLACK;
+            sibling->left->color = BLACK;
+            rotateRight(tree, parent);
+            node = tree->base.root;
+        }
+    }
+    if (node != NULL)
+    {
+        node->color = BLACK;
+    }
+}
+
+/**
+ * makes 'replacement' take the place of 'node' in the link from node's parent
+ */
+static void replaceChild(RBTree *tree, Node *node, Node *replacement)
+{
+    if (node->parent == NULL)
+    {
+        tree->root = replacement;
+    }
+    else if (node->parent->left == node)
+    {
+        node->parent->left = replacement;
+    }
+    else
+    {
+        node->parent->right = replacement;
+    }
+}
+
+void extUnlinkNode(RBTreeEx *tree, Node *node)
+{
+    Node *child, *parent;
+    Color removedColor;
+    if (node->left == NULL || node->right == NULL)
+    {
+        child = node->left != NULL ? node->left : node->right;
+        parent = node->parent;
+        removedColor = node->color;
+        if (child != NULL)
+        {
+            child->parent = parent;
+        }
+        replaceChild(&tree->base, node, child);
+    }
+    else
+    {
+        // the successor takes node's place, and the successor's own place is the one that loses a node
+        Node *successor = node->right;
+        while (successor->left != NULL)
+        {
+            successor = successor->left;
+        }
+        child = successor->right;
+        removedColor = successor->color;
+        if (successor->parent == node)
+        {
+            parent = successor;
+        }
+        else
+        {
+            parent = successor->parent;
+            parent->left = child;
+            if (child != NULL)
+            {
+                child->parent = parent;
+            }
+            successor->right = node->right;
+            node->right->parent = successor;
+        }
+        successor->left = node->left;
+        node->left->parent = successor;
+        successor->color = node->color;
+        successor->parent = node->parent;
+        replaceChild(&tree->base, node, successor);
+    }
+    if (tree->orderStatistics)
+    {
+        // only the subtrees on the path from the position that lost a node up to the root have shrunk
+        for (Node *ancestor = parent; ancestor != NULL; ancestor = ancestor->parent)
+        {
+            updateCount(ancestor);
+        }
+    }
+    if (removedColor == BLACK)
+    {
+        fixAfterRemove(tree, child, parent);
+    }
+}
+
+Node *extFindFrom(const RBTree *tree, Node *start, const void *data, Node **parent, Node ***link)
+{
+    *parent = start != NULL ? start->parent : NULL;
+    if (*parent == NULL)
+    {
+        *link = (Node **) &tree->root;
+    }
+    else
+    {
+        *link = start == (*parent)->left ? &(*parent)->left : &(*parent)->right;
+    }
+    while (**link != NULL)
+    {
+        Node *node = **link;
+        int cmp = tree->compFunc(data, node->data);
+        if (cmp == 0)
+        {
+            return node;
+        }
+        *parent = node;
+        *link = cmp < 0 ? &node->left : &node->right;
+    }
+    return NULL;
+}
+
+Node *extFindFromHint(const RBTree *tree, Node *hint, const void *data, Node **parent, Node ***link)
+{
+    if (hint == NULL)
+    {
+        return extFindFrom(tree, NULL, data, parent, link);
+    }
+    int cmp = tree->compFunc(data, hint->data);
+    if (cmp == 0)
+    {
+        return hint;
+    }
+    // climb until the range of the subtree at 'top' covers 'data'. That range ends (on data's side) at the first
+    // ancestor 'top' is on the other side of - climbing through the ancestors it's on the same side of doesn't
+    // widen it
+    Node *top = hint;
+    while (1)
+    {
+        Node *ancestor = top;
+        while (ancestor->parent != NULL && ancestor == (cmp > 0 ? ancestor->parent->right : ancestor->parent->left))
+        {
+            ancestor = ancestor->parent;
+        }
+        Node *bound = ancestor->parent;
+        if (bound == NULL)
+        {
+            break;
+        }
+        int boundCmp = tree->compFunc(data, bound->data);
+        if (boundCmp == 0)
+        {
+            return bound;
+        }
+        if ((boundCmp < 0) == (cmp > 0))
+        {
+            break;
+        }
+        top = bound;
+    }
+    return extFindFrom(tree, top, data, parent, link);
+}
+
+Node *extLinkNewNode(RBTreeEx *tree, void *data, Node *parent, Node **link)
+{
+    Node *node = extAllocNode(tree, data);
+    if (node == NULL)
+    {
+        return NULL;
+    }
+    node->parent = parent;
+    node->left = NULL;
+    node->right = NULL;
+    node->color = RED;
+    node->data = data;
+    *link = node;
+    if (tree->orderStatistics)
+    {
+        ((CountedNode *) node)->count = 1;
+        for (Node *ancestor = parent; ancestor != NULL; ancestor = ancestor->parent)
+        {
+            ((CountedNode *) ancestor)->count++;
+        }
+    }
+    extFixAfterInsert(tree, node);
+    tree->base.size++;
+    return node;
+}
+
+int extRedDepth(size_t n)
+{
+    // the deepest level is floor(log2(n)) - unless that's the root, which must stay black
+    int depth = 0;
+    for (size_t remaining = n; remaining > 1; remaining /= 2)
+    {
+        depth++;
+    }
+    return depth > 0 ? depth : -1;
+}
+
+int extLinkBalanced(RBTreeEx *tree, void **items, Node **nodes, size_t n, Node *parent, Node **link, int depth,
+                    int redDepth)
+{
+    if (n == 0)
+    {
+        *link = NULL;
+        return 1;
+    }
+    size_t middle = n / 2;
+    Node *node;
+    if (nodes != NULL)
+    {
+        node = nodes[middle];
+    }
+    else if ((node = extAllocNode(tree, items[middle])) != NULL)
+    {
+        node->data = items[middle];
+    }
+    else
+    {
+        return 0;
+    }
+    node->parent = parent;
+    node->left = NULL;
+    node->right = NULL;
+    node->color = depth == redDepth ? RED : BLACK;
+    if (tree->orderStatistics)
+    {
+        ((CountedNode *) node)->count = n;
+    }
+    *link = node;
+    return extLinkBalanced(tree, items, nodes, middle, node, &node->left, depth + 1, redDepth) &&
+           extLinkBalanced(tree, items != NULL ? items + middle + 1 : NULL, nodes != NULL ? nodes + middle + 1 : NULL,
+                           n - middle - 1, node, &node->right, depth + 1, redDepth);
+}
+
+RBTreeEx *newRBTreeEx(CompareFunc compFunc, FreeFunc freeFunc, const RBTreeConfig *config)
+{
+    // an intrusive tree's nodes are its items' hooks, there's nothing to allocate or count in them
+    if (compFunc == NULL || (config != NULL && config->intrusive && (config->useArena || config->orderStatistics)))
+    {
+        return NULL;
+    }
+    RBTreeEx *tree = (RBTreeEx *) malloc(sizeof(RBTreeEx));
+    if (tree == NULL)
+    {
+        return NULL;
+    }
+    tree->base.root = NULL;
+    tree->base.compFunc = compFunc;
+    tree->base.freeFunc = freeFunc;
+    tree->base.size = 0;
+    tree->arena = NULL;
+    tree->orderStatistics = config != NULL && config->orderStatistics;
+    tree->intrusive = config != NULL && config->intrusive;
+    tree->hookOffset = tree->intrusive ? config->hookOffset : 0;
+    if (config != NULL && config->useArena)
+    {
+        tree->arena = newNodeArena(nodeSize(tree->orderStatistics), config->maxIdleChunks);
+        if (tree->arena == NULL)
+        {
+            free(tree);
+            return NULL;
+        }
+    }
+    return tree;
+}
+
+RBTreeEx *newRBTreeExLike(const RBTreeEx *tree)
+{
+    if (tree == NULL)
+    {
+        return NULL;
+    }
+    RBTreeEx *copy = (RBTreeEx *) malloc(sizeof(RBTreeEx));
+    if (copy == NULL)
+    {
+        return NULL;
+    }
+    *copy = *tree;
+    copy->base.root = NULL;
+    copy->base.size = 0;
+    copy->arena = nodeArenaRetain(tree->arena);
+    return copy;
+}
+
+RBTreeEx *newRBTreeFromSorted(CompareFunc compFunc, FreeFunc freeFunc, void **items, size_t n,
+                              const RBTreeConfig *config, int verifySorted)
+{
+    if (compFunc == NULL || (items == NULL && n > 0) || n > INT_MAX)
+    {
+        return NULL;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        if (items[i] == NULL || (verifySorted && i > 0 && compFunc(items[i - 1], items[i]) >= 0))
+        {
+            return NULL;
+        }
+    }
+    RBTreeEx *tree = newRBTreeEx(compFunc, freeFunc, config);
+    if (tree == NULL)
+    {
+        return NULL;
+    }
+    if (!extLinkBalanced(tree, items, NULL, n, NULL, &tree->base.root, 0, extRedDepth(n)))
+    {
+        // the items still belong to the caller
+        tree->base.freeFunc = NULL;
+        freeRBTreeEx(tree);
+        return NULL;
+    }
+    tree->base.size = (int) n;
+    return tree;
+}
+
+int addToRBTreeEx(RBTreeEx *tree, void *data)
+{
+    if (tree == NULL || data == NULL)
+    {
+        return 0;
+    }
+    Node *parent, **link;
+    if (extFindFrom(&tree->base, NULL, data, &parent, &link) != NULL)
+    {
+        return 0;
+    }
+    return extLinkNewNode(tree, data, parent, link) != NULL;
+}
+
+Node *addToRBTreeHint(RBTreeEx *tree, void *data, Node *hint)
+{
+    if (tree == NULL || data == NULL)
+    {
+        return NULL;
+    }
+    Node *parent, **link;
+    if (extFindFromHint(&tree->base, hint, data, &parent, &link) != NULL)
+    {
+        return NULL;
+    }
+    return extLinkNewNode(tree, data, parent, link);
+}
+
+int findOrAddRBTree(RBTreeEx *tree, void *data, void **existing)
+{
+    if (tree == NULL || data == NULL)
+    {
+        return 0;
+    }
+    Node *parent, **link;
+    Node *node = extFindFrom(&tree->base, NULL, data, &parent, &link);
+    if (node == NULL && extLinkNewNode(tree, data, parent, link) == NULL)
+    {
+        return 0;
+    }
+    if (existing != NULL)
+    {
+        *existing = node != NULL ? node->data : NULL;
+    }
+    return 1;
+}
+
+/**
+ * makes 'data' the item of 'node', which holds an item equal to it.
+ */
+static void replaceItem(RBTreeEx *tree, Node *node, void *data)
+{
+    if (!tree->intrusive)
+    {
+        node->data = data;
+        return;
+    }
+    // the node is part of the old item, so the new item's own hook takes its place
+    Node *hook = extAllocNode(tree, data);
+    *hook = *node;
+    hook->data = data;
+    replaceChild(&tree->base, node, hook);
+    if (hook->left != NULL)
+    {
+        hook->left->parent = hook;
+    }
+    if (hook->right != NULL)
+    {
+        hook->right->parent = hook;
+    }
+}
+
+int addOrReplaceRBTree(RBTreeEx *tree, void *data, int freeOld, void **replaced)
+{
+    if (tree == NULL || data == NULL)
+    {
+        return 0;
+    }
+    Node *parent, **link;
+    Node *node = extFindFrom(&tree->base, NULL, data, &parent, &link);
+    void *old = NULL;
+    if (node == NULL)
+    {
+        if (extLinkNewNode(tree, data, parent, link) == NULL)
+        {
+            return 0;
+        }
+    }
+    else if (node->data != data)
+    {
+        old = node->data;
+        replaceItem(tree, node, data);
+        if (freeOld && tree->base.freeFunc != NULL)
+        {
+            tree->base.freeFunc(old);
+        }
+    }
+    if (replaced != NULL)
+    {
+        *replaced = old;
+    }
+    return 1;
+}
+
+int removeFromRBTree(RBTreeEx *tree, const void *data, int freeData)
+{
+    if (tree == NULL || data == NULL)
+    {
+        return 0;
+    }
+    Node *parent, **link;
+    Node *node = extFindFrom(&tree->base, NULL, data, &parent, &link);
+    if (node == NULL)
+    {
+        return 0;
+    }
+    extUnlinkNode(tree, node);
+    tree->base.size--;
+    if (freeData && tree->base.freeFunc != NULL)
+    {
+        tree->base.freeFunc(node->data);
+    }
+    extReleaseNode(tree, node);
+    return 1;
+}
+
+void extReleaseSubtree(RBTreeEx *tree, Node *root, FreeFunc freeFunc, int releaseNodes)
+{
+    // post-order walk that unlinks every leaf it frees, so no stack is needed
+    Node *node = root;
+    while (node != NULL)
+    {
+        if (node->left != NULL)
+        {
+            node = node->left;
+        }
+        else if (node->right != NULL)
+        {
+            node = node->right;
+        }
+        else
+        {
+            Node *parent = node->parent;
+            if (parent != NULL)
+            {
+                if (parent->left == node)
+                {
+                    parent->left = NULL;
+                }
+                else
+                {
+                    parent->right = NULL;
+                }
+            }
+            if (freeFunc != NULL)
+            {
+                freeFunc(node->data);
+            }
+            if (releaseNodes)
+            {
+                extReleaseNode(tree, node);
+            }
+            node = parent;
+        }
+    }
+}
+
+void freeRBTreeEx(RBTreeEx *tree)
+{
+    if (tree == NULL)
+    {
+        return;
+    }
+    // an arena that only this tree uses, without a FreeFunc, doesn't need to visit the nodes at all
+    int releaseNodes = !tree->intrusive && (tree->arena == NULL || nodeArenaIsShared(tree->arena));
+    if (releaseNodes || tree->base.freeFunc != NULL)
+    {
+        extReleaseSubtree(tree, tree->base.root, tree->base.freeFunc, releaseNodes);
+    }
+    freeNodeArena(tree->arena);
+    free(tree);
+}
+
+void *selectRBTree(const RBTreeEx *tree, int k)
+{
+    if (tree == NULL || !tree->orderStatistics || k < 0 || k >= tree->base.size)
+    {
+        return NULL;
+    }
+    size_t remaining = (size_t) k;
+    Node *node = tree->base.root;
+    while (node != NULL)
+    {
+        size_t leftCount = countOf(node->left);
+        if (remaining < leftCount)
+        {
+            node = node->left;
+        }
+        else if (remaining == leftCount)
+        {
+            return node->data;
+        }
+        else
+        {
+            remaining -= leftCount + 1;
+            node = node->right;
+        }
+    }
+    return NULL;
+}
+
+int rankRBTree(const RBTreeEx *tree, const void *data)
+{
+    if (tree == NULL || !tree->orderStatistics || data == NULL)
+    {
+        return -1;
+    }
+    size_t rank = 0;
+    Node *node = tree->base.root;
+    while (node != NULL)
+    {
+        int cmp = tree->base.compFunc(data, node->data);
+        if (cmp <= 0)
+        {
+            if (cmp == 0)
+            {
+                return (int) (rank + countOf(node->left));
+            }
+            node = node->left;
+        }
+        else
+        {
+            rank += countOf(node->left) + 1;
+            node = node->right;
+        }
+    }
+    return (int) rank;
+}
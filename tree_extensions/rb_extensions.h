@@ -0,0 +1,201 @@
+#ifndef RB_EXTENSIONS_H
+#define RB_EXTENSIONS_H
+
+#include <stddef.h>
+#include "RBTree.h"
+#include "node_arena.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * options for creating a RBTreeEx.
+ */
+typedef struct RBTreeConfig
+{
+    /// 0: every node is malloc'd on its own (like RBTree.c does), other: nodes are carved out of a per-tree NodeArena
+    int useArena;
+    /// only used with an arena: how many empty chunks are kept for reuse once the tree shrinks, before they're
+    /// returned to the OS (NODE_ARENA_KEEP_ALL to keep them until the tree is freed)
+    size_t maxIdleChunks;
+    /// other than 0 to have every node keep the size of its subtree, which enables selectRBTree and rankRBTree at the
+    /// cost of one extra word per node
+    int orderStatistics;
+    /// other than 0 for an intrusive tree: every item embeds the Node that links it into the tree (a "hook"), so the
+    /// tree allocates nothing, and an item and its node share cache lines. Can't be combined with the two options
+    /// above. An item may only be in one intrusive tree per hook at a time, and stays linked until removed or until
+    /// the tree is freed
+    int intrusive;
+    /// only used by intrusive trees: the offset of the hook within the items, e.g offsetof(Product, hook)
+    size_t hookOffset;
+} RBTreeConfig;
+
+/**
+ * a RBTree whose memory is managed by this library.
+ * 'base' is a regular RBTree, so '&tree->base' may be given to every function of RBTree.h that doesn't modify the
+ * tree (containsRBTree, forEachRBTree), as well as to the tree visualizer. Adding and freeing must go through the
+ * functions below.
+ */
+typedef struct RBTreeEx
+{
+    RBTree base;
+    NodeArena *arena;
+    int orderStatistics;
+    int intrusive;
+    size_t hookOffset;
+} RBTreeEx;
+
+/**
+ * constructs a new RBTreeEx.
+ * @param compFunc: a function two compare two variables.
+ * @param freeFunc: a function to free a data item, may be NULL.
+ * @param config: options for the tree, NULL for the defaults (no arena).
+ * @return: the new tree, or NULL on failure.
+ */
+RBTreeEx *newRBTreeEx(CompareFunc compFunc, FreeFunc freeFunc, const RBTreeConfig *config);
+
+/**
+ * constructs a new, empty RBTreeEx with the CompareFunc, FreeFunc and settings of another tree, sharing its arena (if
+ * any). Trees that share an arena can be joined (and combined by the set operations of rb_parallel.h), but mustn't be
+ * modified concurrently.
+ * @param tree: the tree to copy the settings of.
+ * @return: the new tree, or NULL on failure.
+ */
+RBTreeEx *newRBTreeExLike(const RBTreeEx *tree);
+
+/**
+ * constructs a RBTreeEx holding already sorted items, in O(n) and without calling compFunc.
+ * the result is perfectly balanced: every nil is at one of two adjacent depths.
+ * @param compFunc: a function two compare two variables.
+ * @param freeFunc: a function to free a data item, may be NULL.
+ * @param items: the items, in strictly ascending order.
+ * @param n: number of items.
+ * @param config: options for the tree, NULL for the defaults (no arena).
+ * @param verifySorted: other than 0 to check (with n - 1 comparisons) that the items are strictly ascending.
+ * @return: the new tree, or NULL on failure (including unsorted items when checked). On failure, the items aren't
+ * freed.
+ */
+RBTreeEx *newRBTreeFromSorted(CompareFunc compFunc, FreeFunc freeFunc, void **items, size_t n,
+                              const RBTreeConfig *config, int verifySorted);
+
+/**
+ * add an item to the tree
+ * @param tree: the tree to add an item to.
+ * @param data: item to add to the tree.
+ * @return: 0 on failure, other on success. (if the item is already in the tree - failure).
+ */
+int addToRBTreeEx(RBTreeEx *tree, void *data);
+
+/**
+ * add an item to the tree, searching for its place from a node near it rather than from the root: the search climbs
+ * from 'hint' only as far as needed. Costs O(log d) comparisons, where d is the number of items between the hint's
+ * and 'data' - so adding sorted (or nearly sorted) items, each with the previous one's node as the hint, costs
+ * amortised O(1) comparisons per item.
+ * @param tree: the tree to add an item to.
+ * @param data: item to add to the tree.
+ * @param hint: a node of the tree, typically the one returned by the previous call. NULL to search from the root.
+ * Nodes are never moved between items, so a node stays a valid hint until its item is removed.
+ * @return: the node holding 'data', to be used as the next hint - or NULL on failure (if the item is already in the
+ * tree - failure).
+ */
+Node *addToRBTreeHint(RBTreeEx *tree, void *data, Node *hint);
+
+/**
+ * add a batch of items to the tree.
+ * the batch is sorted with the tree's CompareFunc, and then merged into the tree: batches at least as large as the
+ * tree are merged with a single in-order walk (and the tree rebuilt, reusing its nodes), smaller ones are inserted in
+ * order, starting each search from the previously inserted node. Either way this costs O(m log(n/m + 1))
+ * comparisons after sorting.
+ * @param tree: the tree to add the items to.
+ * @param items: the items to add, in any order.
+ * @param m: number of items.
+ * @param results: may be NULL. Otherwise results[i] is set to what addToRBTreeEx(tree, items[i]) would have returned
+ * had the items been added one by one, in order: 0 for an item already in the tree or in the batch before it.
+ * @return: 0 on failure, other on success. On failure, 'results' still tells which items were added.
+ */
+int addManyToRBTree(RBTreeEx *tree, void **items, size_t m, int *results);
+
+/**
+ * split a tree around a pivot. In order-statistic mode this costs O(log n). Otherwise the size of each tree is only
+ * known by walking the smaller one, so it costs O(log n + min(|left|, |right|)) - O(n) for a pivot near the median.
+ * @param tree: the tree to split. It is consumed: it becomes one of the two results.
+ * @param pivot: compared with the tree's items. It doesn't have to be in the tree.
+ * @param left: set to a tree of the items < pivot.
+ * @param right: set to a tree of the items >= pivot.
+ * both trees have the settings of the original tree, and share its arena (if any) - so they mustn't be modified
+ * concurrently.
+ * @return: 0 on failure (the tree is left unchanged), other on success.
+ */
+int splitRBTree(RBTreeEx *tree, const void *pivot, RBTreeEx **left, RBTreeEx **right);
+
+/**
+ * join two trees in O(log n), where every item of 'left' is smaller than every item of 'right'.
+ * both trees must have the same CompareFunc, FreeFunc and mode, and share the same arena (or both have none) - like
+ * two trees that were split from one tree, or created with newRBTreeExLike.
+ * @param left: the tree of the smaller items. It is consumed: it becomes the result.
+ * @param right: the tree of the greater items. It is consumed: it is freed (without its items).
+ * @return: the joined tree, or NULL on failure (the trees are left unchanged).
+ */
+RBTreeEx *joinRBTree(RBTreeEx *left, RBTreeEx *right);
+
+/**
+ * add an item to the tree, unless an equal item is already there - in which case that item is returned instead. Takes a
+ * single descent, where checking with containsRBTree first would take two.
+ * @param tree: the tree to add an item to.
+ * @param data: item to add to the tree.
+ * @param existing: may be NULL. Set to the stored item equal to 'data', or to NULL if 'data' was added.
+ * @return: 0 on failure, other on success (whether or not 'data' was added).
+ */
+int findOrAddRBTree(RBTreeEx *tree, void *data, void **existing);
+
+/**
+ * add an item to the tree, or if an equal item is already there, put 'data' in its place - in a single descent.
+ * In an intrusive tree, the node embedded in 'data' takes the place of the old item's node.
+ * @param tree: the tree to add an item to.
+ * @param data: item to add to the tree.
+ * @param freeOld: other than 0 to call the tree's FreeFunc (if any) on the replaced item.
+ * @param replaced: may be NULL. Set to the replaced item, or to NULL if 'data' was added (or was the stored item
+ * itself, which is then left as is). If 'freeOld' is set, it has already been freed.
+ * @return: 0 on failure, other on success.
+ */
+int addOrReplaceRBTree(RBTreeEx *tree, void *data, int freeOld, void **replaced);
+
+/**
+ * remove an item from the tree in O(log n), rebalancing it in place.
+ * @param tree: the tree to remove an item from.
+ * @param data: an item equal (by the tree's CompareFunc) to the one to remove.
+ * @param freeData: other than 0 to call the tree's FreeFunc (if any) on the stored item.
+ * @return: 0 on failure, other on success. (if the item isn't in the tree - failure).
+ */
+int removeFromRBTree(RBTreeEx *tree, const void *data, int freeData);
+
+/**
+ * free all memory of the data structure, calling the tree's FreeFunc (if any) on every item.
+ * when the tree uses an arena, its nodes are released chunk by chunk rather than one by one.
+ * @param tree: the tree to free.
+ */
+void freeRBTreeEx(RBTreeEx *tree);
+
+/**
+ * find the k-th smallest item in O(log n). The tree must be in order-statistic mode.
+ * @param tree: the tree to search.
+ * @param k: index of the item in ascending order, starting at 0.
+ * @return: the item, or NULL if k is out of range (or the tree isn't in order-statistic mode).
+ */
+void *selectRBTree(const RBTreeEx *tree, int k);
+
+/**
+ * find the rank of an item in O(log n). The tree must be in order-statistic mode.
+ * @param tree: the tree to search.
+ * @param data: the item to rank. It doesn't have to be in the tree.
+ * @return: the number of items in the tree smaller than 'data' (so for an item of the tree, its index in ascending
+ * order), or -1 on failure.
+ */
+int rankRBTree(const RBTreeEx *tree, const void *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RB_EXTENSIONS_H
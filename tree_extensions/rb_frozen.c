@@ -0,0 +1,164 @@
+// posix_memalign
+#define _POSIX_C_SOURCE 200112L
+
+#include "rb_frozen.h"
+#include "rb_queries.h"
+#include <stdlib.h>
+
+#define CACHE_LINE (64)
+// the 8 descendants of position k three levels down are at 8k to 8k + 7 - a single cache line of item pointers
+#define PREFETCH_STRIDE (CACHE_LINE / sizeof(void *))
+
+struct FrozenRBTree
+{
+    CompareFunc compFunc;
+    size_t size;
+    void **items; // items[1] to items[size] in Eytzinger order, aligned so items[PREFETCH_STRIDE * k] starts a line
+};
+
+/**
+ * @return: the position after 'position' in ascending order, or 0 if it's the last one.
+ */
+static size_t nextPosition(size_t position, size_t size)
+{
+    if (2 * position + 1 <= size)
+    {
+        position = 2 * position + 1;
+        while (2 * position <= size)
+        {
+            position *= 2;
+        }
+        return position;
+    }
+    // back up to the closest ancestor whose left subtree we're in: drop the trailing right turns, and one left turn
+    return position >> __builtin_ffsll((long long) ~position);
+}
+
+/**
+ * @return: the smallest position in the frozen tree, or 0 if it's empty.
+ */
+static size_t firstPosition(size_t size)
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+    size_t position = 1;
+    while (2 * position <= size)
+    {
+        position *= 2;
+    }
+    return position;
+}
+
+/**
+ * walks from the root to a leaf, turning right at every item < probe (or <= probe, if 'orEqual').
+ * @return: the path taken: after the leading 1, a bit per level - 1 for a right turn.
+ */
+static size_t descend(const FrozenRBTree *frozen, const void *probe, int orEqual)
+{
+    void *const *items = frozen->items;
+    size_t size = frozen->size;
+    size_t position = 1;
+    while (position <= size)
+    {
+        // prefetching past the end of the array is harmless, it never faults
+        __builtin_prefetch(items + PREFETCH_STRIDE * position);
+        int cmp = frozen->compFunc(probe, items[position]);
+        position = 2 * position + (orEqual ? cmp >= 0 : cmp > 0);
+    }
+    return position;
+}
+
+FrozenRBTree *freezeRBTree(const RBTree *tree)
+{
+    if (tree == NULL || tree->compFunc == NULL || tree->size < 0)
+    {
+        return NULL;
+    }
+    FrozenRBTree *frozen = (FrozenRBTree *) malloc(sizeof(FrozenRBTree));
+    if (frozen == NULL)
+    {
+        return NULL;
+    }
+    frozen->compFunc = tree->compFunc;
+    frozen->size = (size_t) tree->size;
+    void *memory;
+    if (posix_memalign(&memory, CACHE_LINE, (frozen->size + 1) * sizeof(void *)) != 0)
+    {
+        free(frozen);
+        return NULL;
+    }
+    frozen->items = (void **) memory;
+    frozen->items[0] = NULL;
+    // the tree and the positions are both walked in ascending order, so each item lands in its place
+    RBIterator iterator;
+    void *item = firstRBTree(tree, &iterator);
+    for (size_t position = firstPosition(frozen->size); position != 0;
+         position = nextPosition(position, frozen->size))
+    {
+        frozen->items[position] = item;
+        item = nextRBTree(&iterator);
+    }
+    return frozen;
+}
+
+int containsFrozenRBTree(const FrozenRBTree *frozen, const void *data)
+{
+    const void *ceiling = ceilingFrozenRBTree(frozen, data);
+    return ceiling != NULL && frozen->compFunc(data, ceiling) == 0;
+}
+
+void *floorFrozenRBTree(const FrozenRBTree *frozen, const void *probe)
+{
+    if (frozen == NULL || probe == NULL)
+    {
+        return NULL;
+    }
+    // the floor is where the path last turned right: drop the trailing left turns, and that right turn
+    size_t path = descend(frozen, probe, 1);
+    return frozen->items[path >> __builtin_ffsll((long long) path)];
+}
+
+void *ceilingFrozenRBTree(const FrozenRBTree *frozen, const void *probe)
+{
+    if (frozen == NULL || probe == NULL)
+    {
+        return NULL;
+    }
+    // the ceiling is where the path last turned left
+    size_t path = descend(frozen, probe, 0);
+    return frozen->items[path >> __builtin_ffsll((long long) ~path)];
+}
+
+int forEachFrozenRBTree(const FrozenRBTree *frozen, forEachFunc func, void *args)
+{
+    if (frozen == NULL || func == NULL)
+    {
+        return 0;
+    }
+    for (size_t position = firstPosition(frozen->size); position != 0;
+         position = nextPosition(position, frozen->size))
+    {
+        if (!func(frozen->items[position], args))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int sizeOfFrozenRBTree(const FrozenRBTree *frozen)
+{
+    return frozen != NULL ? (int) frozen->size : 0;
+}
+
+void freeFrozenRBTree(FrozenRBTree *frozen)
+{
+    if (frozen == NULL)
+    {
+        return;
+    }
+    free(frozen->items);
+    free(frozen);
+}
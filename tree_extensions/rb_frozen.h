@@ -0,0 +1,71 @@
+#ifndef RB_FROZEN_H
+#define RB_FROZEN_H
+
+#include "RBTree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * An immutable, read-only copy of a RBTree, for trees that are built once and then searched many times.
+ * The items are kept in a single array in Eytzinger (breadth first) order: the children of position k are at 2k and
+ * 2k + 1. A search reads one position per level like a tree would, but the positions of the next levels are known
+ * in advance, so they're prefetched while the current comparison runs - and the search loop has no branches to
+ * mispredict.
+ * it holds the tree's items, not copies of them: they must stay alive (and unchanged) while it's used, and it never
+ * frees them.
+ */
+typedef struct FrozenRBTree FrozenRBTree;
+
+/**
+ * copies a tree into a new frozen tree, in O(n). Works with any RBTree, and doesn't change it.
+ * @param tree: the tree to copy.
+ * @return: the frozen tree, or NULL on failure.
+ */
+FrozenRBTree *freezeRBTree(const RBTree *tree);
+
+/**
+ * check whether the frozen tree contains this item.
+ * @param frozen: the frozen tree to check an item in.
+ * @param data: item to check.
+ * @return: 0 if the item is not in the tree, other if it is.
+ */
+int containsFrozenRBTree(const FrozenRBTree *frozen, const void *data);
+
+/**
+ * @return: the greatest item <= probe, or NULL if there's none.
+ */
+void *floorFrozenRBTree(const FrozenRBTree *frozen, const void *probe);
+
+/**
+ * @return: the smallest item >= probe, or NULL if there's none.
+ */
+void *ceilingFrozenRBTree(const FrozenRBTree *frozen, const void *probe);
+
+/**
+ * Activate a function on each item of the frozen tree, in ascending order. if one of the activations of the function
+ * returns 0, the process stops.
+ * @param frozen: the frozen tree with all the items.
+ * @param func: the function to activate on all items.
+ * @param args: more optional arguments to the function (may be null if the given function support it).
+ * @return: 0 on failure, other on success.
+ */
+int forEachFrozenRBTree(const FrozenRBTree *frozen, forEachFunc func, void *args);
+
+/**
+ * @return: number of items in the frozen tree.
+ */
+int sizeOfFrozenRBTree(const FrozenRBTree *frozen);
+
+/**
+ * free all memory of the frozen tree. (not the items, which belong to the original tree)
+ * @param frozen: the frozen tree to free.
+ */
+void freeFrozenRBTree(FrozenRBTree *frozen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RB_FROZEN_H
@@ -0,0 +1,313 @@
+#include "rb_indexed.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_CAPACITY (16)
+// a parent index has 31 bits, so that's the last usable slot
+#define MAX_CAPACITY ((uint32_t) 1 << 31)
+
+static void replaceChild(IndexedRBTree *tree, uint32_t node, uint32_t replacement)
+{
+    uint32_t parent = INDEXED_PARENT(&tree->nodes[node]);
+    if (parent == INDEXED_NONE)
+    {
+        tree->root = replacement;
+    }
+    else if (node == tree->nodes[parent].left)
+    {
+        tree->nodes[parent].left = replacement;
+    }
+    else
+    {
+        tree->nodes[parent].right = replacement;
+    }
+}
+
+static void rotateLeft(IndexedRBTree *tree, uint32_t node)
+{
+    IndexedNode *nodes = tree->nodes;
+    uint32_t pivot = nodes[node].right;
+    nodes[node].right = nodes[pivot].left;
+    if (nodes[pivot].left != INDEXED_NONE)
+    {
+        INDEXED_SET_PARENT(&nodes[nodes[pivot].left], node);
+    }
+    INDEXED_SET_PARENT(&nodes[pivot], INDEXED_PARENT(&nodes[node]));
+    replaceChild(tree, node, pivot);
+    nodes[pivot].left = node;
+    INDEXED_SET_PARENT(&nodes[node], pivot);
+}
+
+static void rotateRight(IndexedRBTree *tree, uint32_t node)
+{
+    IndexedNode *nodes = tree->nodes;
+    uint32_t pivot = nodes[node].left;
+    nodes[node].left = nodes[pivot].right;
+    if (nodes[pivot].right != INDEXED_NONE)
+    {
+        INDEXED_SET_PARENT(&nodes[nodes[pivot].right], node);
+    }
+    INDEXED_SET_PARENT(&nodes[pivot], INDEXED_PARENT(&nodes[node]));
+    replaceChild(tree, node, pivot);
+    nodes[pivot].right = node;
+    INDEXED_SET_PARENT(&nodes[node], pivot);
+}
+
+static int isRed(const IndexedRBTree *tree, uint32_t node)
+{
+    return node != INDEXED_NONE && INDEXED_COLOR(&tree->nodes[node]) == RED;
+}
+
+static void fixAfterInsert(IndexedRBTree *tree, uint32_t node)
+{
+    IndexedNode *nodes = tree->nodes;
+    uint32_t parent;
+    while ((parent = INDEXED_PARENT(&nodes[node])) != INDEXED_NONE && isRed(tree, parent))
+    {
+        uint32_t grandparent = INDEXED_PARENT(&nodes[parent]);
+        int parentIsLeft = parent == nodes[grandparent].left;
+        uint32_t uncle = parentIsLeft ? nodes[grandparent].right : nodes[grandparent].left;
+        if (isRed(tree, uncle))
+        {
+            INDEXED_SET_COLOR(&nodes[parent], BLACK);
+            INDEXED_SET_COLOR(&nodes[uncle], BLACK);
+            INDEXED_SET_COLOR(&nodes[grandparent], RED);
+            node = grandparent;
+            continue;
+        }
+        if (parentIsLeft)
+        {
+            if (node == nodes[parent].right)
+            {
+                rotateLeft(tree, parent);
+                parent = node;
+            }
+            rotateRight(tree, grandparent);
+        }
+        else
+        {
+            if (node == nodes[parent].left)
+            {
+                rotateRight(tree, parent);
+                parent = node;
+            }
+            rotateLeft(tree, grandparent);
+        }
+        INDEXED_SET_COLOR(&nodes[parent], BLACK);
+        INDEXED_SET_COLOR(&nodes[grandparent], RED);
+        break;
+    }
+    INDEXED_SET_COLOR(&nodes[tree->root], BLACK);
+}
+
+/**
+ * makes room for 'capacity' slots in both arrays. As links are indices, moving the arrays breaks nothing.
+ * @return: 0 on failure, other on success.
+ */
+static int reserve(IndexedRBTree *tree, uint32_t capacity)
+{
+    // may overflow only where size_t has 32 bits. A node is bigger than an item pointer, so that's the one to check
+    size_t bytes = (size_t) capacity * sizeof(IndexedNode);
+    if (bytes / sizeof(IndexedNode) != capacity)
+    {
+        return 0;
+    }
+    IndexedNode *nodes = (IndexedNode *) realloc(tree->nodes, bytes);
+    if (nodes == NULL)
+    {
+        return 0;
+    }
+    tree->nodes = nodes;
+    void **items = (void **) realloc(tree->items, capacity * sizeof(void *));
+    if (items == NULL)
+    {
+        return 0;
+    }
+    tree->items = items;
+    tree->capacity = capacity;
+    return 1;
+}
+
+IndexedRBTree *newIndexedRBTree(CompareFunc compFunc, FreeFunc freeFunc)
+{
+    if (compFunc == NULL)
+    {
+        return NULL;
+    }
+    IndexedRBTree *tree = (IndexedRBTree *) malloc(sizeof(IndexedRBTree));
+    if (tree == NULL)
+    {
+        return NULL;
+    }
+    tree->root = INDEXED_NONE;
+    tree->compFunc = compFunc;
+    tree->freeFunc = freeFunc;
+    tree->size = 0;
+    tree->nodes = NULL;
+    tree->items = NULL;
+    tree->capacity = 0;
+    return tree;
+}
+
+int addToIndexedRBTree(IndexedRBTree *tree, void *data)
+{
+    if (tree == NULL || data == NULL)
+    {
+        return 0;
+    }
+    uint32_t parent = INDEXED_NONE;
+    uint32_t node = tree->root;
+    int cmp = 0;
+    while (node != INDEXED_NONE)
+    {
+        cmp = tree->compFunc(data, tree->items[node]);
+        if (cmp == 0)
+        {
+            return 0;
+        }
+        parent = node;
+        node = cmp < 0 ? tree->nodes[node].left : tree->nodes[node].right;
+    }
+    // nodes are never removed, so the next free slot is always right after the last one
+    node = (uint32_t) tree->size + 1;
+    if (node >= tree->capacity)
+    {
+        if (tree->capacity >= MAX_CAPACITY)
+        {
+            return 0;
+        }
+        uint32_t capacity = tree->capacity < MAX_CAPACITY / 2 ? tree->capacity * 2 : MAX_CAPACITY;
+        if (!reserve(tree, capacity < INITIAL_CAPACITY ? INITIAL_CAPACITY : capacity))
+        {
+            return 0;
+        }
+    }
+    IndexedNode *newNode = &tree->nodes[node];
+    newNode->parentAndColor = 0;
+    INDEXED_SET_PARENT(newNode, parent);
+    INDEXED_SET_COLOR(newNode, RED);
+    newNode->left = INDEXED_NONE;
+    newNode->right = INDEXED_NONE;
+    tree->items[node] = data;
+    if (parent == INDEXED_NONE)
+    {
+        tree->root = node;
+    }
+    else if (cmp < 0)
+    {
+        tree->nodes[parent].left = node;
+    }
+    else
+    {
+        tree->nodes[parent].right = node;
+    }
+    tree->size++;
+    fixAfterInsert(tree, node);
+    return 1;
+}
+
+int containsIndexedRBTree(const IndexedRBTree *tree, const void *data)
+{
+    if (tree == NULL || data == NULL)
+    {
+        return 0;
+    }
+    uint32_t node = tree->root;
+    while (node != INDEXED_NONE)
+    {
+        int cmp = tree->compFunc(data, tree->items[node]);
+        if (cmp == 0)
+        {
+            return 1;
+        }
+        node = cmp < 0 ? tree->nodes[node].left : tree->nodes[node].right;
+    }
+    return 0;
+}
+
+int forEachIndexedRBTree(const IndexedRBTree *tree, forEachFunc func, void *args)
+{
+    if (tree == NULL || func == NULL)
+    {
+        return 0;
+    }
+    const IndexedNode *nodes = tree->nodes;
+    uint32_t node = tree->root;
+    while (node != INDEXED_NONE && nodes[node].left != INDEXED_NONE)
+    {
+        node = nodes[node].left;
+    }
+    while (node != INDEXED_NONE)
+    {
+        if (!func(tree->items[node], args))
+        {
+            return 0;
+        }
+        if (nodes[node].right != INDEXED_NONE)
+        {
+            node = nodes[node].right;
+            while (nodes[node].left != INDEXED_NONE)
+            {
+                node = nodes[node].left;
+            }
+        }
+        else
+        {
+            uint32_t parent = INDEXED_PARENT(&nodes[node]);
+            while (parent != INDEXED_NONE && node == nodes[parent].right)
+            {
+                node = parent;
+                parent = INDEXED_PARENT(&nodes[node]);
+            }
+            node = parent;
+        }
+    }
+    return 1;
+}
+
+IndexedRBTree *copyIndexedRBTree(const IndexedRBTree *tree)
+{
+    if (tree == NULL)
+    {
+        return NULL;
+    }
+    IndexedRBTree *copy = newIndexedRBTree(tree->compFunc, NULL);
+    if (copy == NULL)
+    {
+        return NULL;
+    }
+    if (tree->size > 0)
+    {
+        // only the slots in use, there's no need for the spare capacity
+        uint32_t used = (uint32_t) tree->size + 1;
+        if (!reserve(copy, used))
+        {
+            freeIndexedRBTree(copy);
+            return NULL;
+        }
+        memcpy(copy->nodes, tree->nodes, used * sizeof(IndexedNode));
+        memcpy(copy->items, tree->items, used * sizeof(void *));
+    }
+    copy->root = tree->root;
+    copy->size = tree->size;
+    return copy;
+}
+
+void freeIndexedRBTree(IndexedRBTree *tree)
+{
+    if (tree == NULL)
+    {
+        return;
+    }
+    // the slots in use are exactly 1 to 'size', no need to walk the tree
+    if (tree->freeFunc != NULL)
+    {
+        for (int i = 1; i <= tree->size; i++)
+        {
+            tree->freeFunc(tree->items[i]);
+        }
+    }
+    free(tree->nodes);
+    free(tree->items);
+    free(tree);
+}
@@ -0,0 +1,103 @@
+#ifndef RB_INDEXED_H
+#define RB_INDEXED_H
+
+#include <stdint.h>
+#include "RBTree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// the index of no node - the slot at index 0 is never used
+#define INDEXED_NONE ((uint32_t) 0)
+
+/**
+ * a 12 byte node, that links to other nodes by their index in the tree's 'nodes' array rather than by pointer. The
+ * color is kept in the lowest bit of 'parentAndColor', and the parent's index in the other 31 bits. Access
+ * 'parentAndColor' only through the macros below.
+ * node i holds the item at 'items[i]' of its tree.
+ */
+typedef struct IndexedNode
+{
+    uint32_t parentAndColor;
+    uint32_t left, right;
+} IndexedNode;
+
+#define INDEXED_PARENT(node) ((node)->parentAndColor >> 1)
+#define INDEXED_COLOR(node) (((node)->parentAndColor & 1) ? BLACK : RED)
+#define INDEXED_SET_PARENT(node, parent) \
+    ((node)->parentAndColor = ((uint32_t) (parent) << 1) | ((node)->parentAndColor & 1))
+#define INDEXED_SET_COLOR(node, color) \
+    ((node)->parentAndColor = ((node)->parentAndColor & ~(uint32_t) 1) | (uint32_t) ((color) == BLACK))
+
+/**
+ * a RBTree whose nodes live in a single growable array. Together with the item pointers (kept in a parallel array)
+ * a node costs 20 bytes, half of a Node. As no link is a pointer, growing the arrays (with realloc) doesn't invalidate
+ * anything, and the whole tree can be copied with a memcpy of each array - see copyIndexedRBTree.
+ * it mirrors RBTree, but as the nodes differ it can't be given to the functions of RBTree.h.
+ */
+typedef struct IndexedRBTree
+{
+    uint32_t root;
+    CompareFunc compFunc;
+    FreeFunc freeFunc;
+    int size;
+    /// 'capacity' slots each, of which 1 to 'size' are in use
+    IndexedNode *nodes;
+    void **items;
+    uint32_t capacity;
+} IndexedRBTree;
+
+/**
+ * constructs a new indexed RBTree with the given CompareFunc.
+ * @param compFunc: a function two compare two variables.
+ * @param freeFunc: a function to free a data item, may be NULL.
+ * @return: the new tree, or NULL on failure.
+ */
+IndexedRBTree *newIndexedRBTree(CompareFunc compFunc, FreeFunc freeFunc);
+
+/**
+ * add an item to the tree
+ * @param tree: the tree to add an item to.
+ * @param data: item to add to the tree.
+ * @return: 0 on failure, other on success. (if the item is already in the tree - failure).
+ */
+int addToIndexedRBTree(IndexedRBTree *tree, void *data);
+
+/**
+ * check whether the tree contains this item.
+ * @param tree: the tree to check an item in.
+ * @param data: item to check.
+ * @return: 0 if the item is not in the tree, other if it is.
+ */
+int containsIndexedRBTree(const IndexedRBTree *tree, const void *data);
+
+/**
+ * Activate a function on each item of the tree, in ascending order. if one of the activations of the function
+ * returns 0, the process stops.
+ * @param tree: the tree with all the items.
+ * @param func: the function to activate on all items.
+ * @param args: more optional arguments to the function (may be null if the given function support it).
+ * @return: 0 on failure, other on success.
+ */
+int forEachIndexedRBTree(const IndexedRBTree *tree, forEachFunc func, void *args);
+
+/**
+ * copies the tree, with one memcpy per array. The copy holds the same items, so its FreeFunc is NULL - it never frees
+ * them.
+ * @param tree: the tree to copy.
+ * @return: the copy, or NULL on failure.
+ */
+IndexedRBTree *copyIndexedRBTree(const IndexedRBTree *tree);
+
+/**
+ * free all memory of the data structure, calling the tree's FreeFunc (if any) on every item.
+ * @param tree: the tree to free.
+ */
+void freeIndexedRBTree(IndexedRBTree *tree);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RB_INDEXED_H
@@ -0,0 +1,142 @@
+#ifndef RB_INTERNAL_H
+#define RB_INTERNAL_H
+
+/*
+ * Helpers shared by the translation units of tree_extensions, not part of its API.
+ * They're prefixed with 'ext' since RBTree.c (and the school solution) may export helpers with the obvious names.
+ */
+
+#include "rb_extensions.h"
+
+// parallel operations don't fork the work of subtrees with a smaller black height (so, with fewer than about 2^8 nodes)
+#define EXT_FORK_HEIGHT (8)
+
+/**
+ * the node of a tree in order-statistic mode. 'node' is first, so a CountedNode* is also a Node*.
+ */
+typedef struct CountedNode
+{
+    Node node;
+    size_t count; // number of nodes in the subtree rooted here
+} CountedNode;
+
+static inline size_t countOf(const Node *node)
+{
+    return node != NULL ? ((const CountedNode *) node)->count : 0;
+}
+
+/**
+ * recomputes the subtree size of 'node' from its children
+ */
+static inline void updateCount(Node *node)
+{
+    ((CountedNode *) node)->count = 1 + countOf(node->left) + countOf(node->right);
+}
+
+/**
+ * @return: other than 0 if the nodes of one tree may be moved into the other.
+ */
+static inline int sameNodeKind(const RBTreeEx *tree, const RBTreeEx *other)
+{
+    return tree->arena == other->arena && tree->orderStatistics == other->orderStatistics &&
+           tree->intrusive == other->intrusive && tree->hookOffset == other->hookOffset;
+}
+
+/**
+ * @return: a node for holding 'data' (its hook, in an intrusive tree), or NULL on failure.
+ */
+Node *extAllocNode(RBTreeEx *tree, void *data);
+
+void extReleaseNode(RBTreeEx *tree, Node *node);
+
+/**
+ * calls 'freeFunc' (if not NULL) on the item of every node of a subtree, and releases the nodes if 'releaseNodes'.
+ * 'root' must have no parent.
+ */
+void extReleaseSubtree(RBTreeEx *tree, Node *root, FreeFunc freeFunc, int releaseNodes);
+
+/**
+ * restores the RB properties after 'node' was linked in as a red node whose children (if any) are black and of equal
+ * black height.
+ * @return: other than 0 if the root was turned from red to black, which adds a black node to every path.
+ */
+int extFixAfterInsert(RBTreeEx *tree, Node *node);
+
+/**
+ * unlinks 'node' from the tree (without changing its size) and rebalances it. Nodes are relinked rather than having
+ * their data swapped, so every other node keeps holding the same item.
+ */
+void extUnlinkNode(RBTreeEx *tree, Node *node);
+
+/**
+ * searches for 'data' in the subtree rooted at 'start' (the whole tree if NULL).
+ * @param parent, link: when 'data' isn't found, set to where a node holding it should be linked.
+ * @return: the node holding an item equal to 'data', or NULL.
+ */
+Node *extFindFrom(const RBTree *tree, Node *start, const void *data, Node **parent, Node ***link);
+
+/**
+ * searches for 'data' starting at 'hint', climbing only as far as needed to reach a subtree whose range covers it.
+ * costs O(log d) comparisons, where d is the number of items between the hint's and 'data'.
+ * @param parent, link: when 'data' isn't found, set to where a node holding it should be linked.
+ * @return: the node holding an item equal to 'data', or NULL.
+ */
+Node *extFindFromHint(const RBTree *tree, Node *hint, const void *data, Node **parent, Node ***link);
+
+/**
+ * allocates a node holding 'data', links it at 'link' (a child link of 'parent', as found by one of the searches
+ * above), and rebalances the tree.
+ * @return: the new node, or NULL on failure.
+ */
+Node *extLinkNewNode(RBTreeEx *tree, void *data, Node *parent, Node **link);
+
+/**
+ * @return: the depth whose nodes should be colored red by extLinkBalanced, for a tree of n nodes.
+ */
+int extRedDepth(size_t n);
+
+/**
+ * links a perfectly balanced subtree at 'link', out of the sorted 'nodes' (or, if 'nodes' is NULL, out of new nodes
+ * holding the sorted 'items'). Every nil is at depth 'redDepth' or below, so coloring the nodes at that depth red and
+ * all others black makes it a valid RB tree.
+ * @return: 0 on failure (allocating a node), other on success.
+ */
+int extLinkBalanced(RBTreeEx *tree, void **items, Node **nodes, size_t n, Node *parent, Node **link, int depth,
+                    int redDepth);
+
+/**
+ * @return: the number of black nodes on a path from 'root' (inclusive) down to a nil.
+ */
+int extBlackHeight(const Node *root);
+
+/**
+ * joins two detached subtrees and a detached node, where every item of 'left' < middle's item < every item of
+ * 'right', into one valid subtree, in O(|leftHeight - rightHeight| + 1).
+ * @param tree: the tree the nodes belong to (for its mode). Its own root isn't touched.
+ * @param left, right: roots of valid subtrees (a red root is fine), or NULL.
+ * @param leftHeight, rightHeight: their black heights, counting their roots as black (0 for NULL).
+ * @param height: may be NULL. Set to the black height of the joined subtree.
+ * @return: root of the joined subtree, which is black and has no parent.
+ */
+Node *extJoin(RBTreeEx *tree, Node *left, int leftHeight, Node *middle, Node *right, int rightHeight, int *height);
+
+/**
+ * splits a detached subtree around 'pivot' in O(log n).
+ * @param height: black height of the subtree, counting its root as black.
+ * @param left: set to the root of a valid subtree of the items < pivot (or NULL), and 'leftHeight' to its black height.
+ * @param right: set to the root of a valid subtree of the items > pivot (or NULL), and 'rightHeight' to its black
+ * height.
+ * @return: the detached node of the item equal to 'pivot', or NULL if there's none.
+ */
+Node *extSplit(RBTreeEx *tree, Node *root, int height, const void *pivot, Node **left, int *leftHeight, Node **right,
+               int *rightHeight);
+
+/**
+ * joins two detached subtrees, where every item of 'left' < every item of 'right', into one valid subtree, in
+ * O(log n).
+ * @param height: may be NULL. Set to the black height of the joined subtree.
+ * @return: root of the joined subtree (NULL if both are empty), which is black and has no parent.
+ */
+Node *extJoin2(RBTreeEx *tree, Node *left, Node *right, int *height);
+
+#endif //RB_INTERNAL_H
@@ -0,0 +1,310 @@
+#include "rb_extensions.h"
+#include "rb_internal.h"
+#include <limits.h>
+#include <stdlib.h>
+
+int extBlackHeight(const Node *root)
+{
+    int height = 0;
+    for (; root != NULL; root = root->left)
+    {
+        height += root->color == BLACK;
+    }
+    return height;
+}
+
+/**
+ * turns a subtree into a standalone tree: no parent and a black root.
+ */
+static Node *detach(Node *root)
+{
+    if (root != NULL)
+    {
+        root->parent = NULL;
+        root->color = BLACK;
+    }
+    return root;
+}
+
+Node *extJoin(RBTreeEx *tree, Node *left, int leftHeight, Node *middle, Node *right, int rightHeight, int *height)
+{
+    detach(left);
+    detach(right);
+    if (leftHeight == rightHeight)
+    {
+        middle->parent = NULL;
+        middle->left = left;
+        middle->right = right;
+        middle->color = BLACK;
+        if (left != NULL)
+        {
+            left->parent = middle;
+        }
+        if (right != NULL)
+        {
+            right->parent = middle;
+        }
+        if (tree->orderStatistics)
+        {
+            updateCount(middle);
+        }
+        if (height != NULL)
+        {
+            *height = leftHeight + 1;
+        }
+        return middle;
+    }
+    // walk down the inner spine of the taller tree to a black node as high (in black nodes) as the shorter tree,
+    // hang the shorter tree and that node under 'middle', and rebalance as if 'middle' was just inserted. That walk is
+    // as long as the difference in heights, which is what makes a split - a join per level - cost O(log n) in total
+    int leftTaller = leftHeight > rightHeight;
+    Node *taller = leftTaller ? left : right;
+    Node *shorter = leftTaller ? right : left;
+    int targetHeight = leftTaller ? rightHeight : leftHeight;
+    int tallerHeight = leftTaller ? leftHeight : rightHeight;
+    int spineHeight = tallerHeight;
+    Node *parent = NULL;
+    Node *spine = taller;
+    while (spine != NULL && !(spine->color == BLACK && spineHeight == targetHeight))
+    {
+        spineHeight -= spine->color == BLACK;
+        parent = spine;
+        spine = leftTaller ? spine->right : spine->left;
+    }
+    middle->parent = parent;
+    middle->color = RED;
+    middle->left = leftTaller ? spine : shorter;
+    middle->right = leftTaller ? shorter : spine;
+    if (spine != NULL)
+    {
+        spine->parent = middle;
+    }
+    if (shorter != NULL)
+    {
+        shorter->parent = middle;
+    }
+    if (leftTaller)
+    {
+        parent->right = middle;
+    }
+    else
+    {
+        parent->left = middle;
+    }
+    if (tree->orderStatistics)
+    {
+        for (Node *ancestor = middle; ancestor != NULL; ancestor = ancestor->parent)
+        {
+            updateCount(ancestor);
+        }
+    }
+    // rebalance within a scratch copy of the tree, so only the joined subtree's root changes
+    RBTreeEx scratch = *tree;
+    scratch.base.root = taller;
+    int grew = extFixAfterInsert(&scratch, middle);
+    if (height != NULL)
+    {
+        *height = tallerHeight + grew;
+    }
+    return scratch.base.root;
+}
+
+Node *extSplit(RBTreeEx *tree, Node *root, int height, const void *pivot, Node **left, int *leftHeight, Node **right,
+               int *rightHeight)
+{
+    if (root == NULL)
+    {
+        *left = NULL;
+        *right = NULL;
+        *leftHeight = 0;
+        *rightHeight = 0;
+        return NULL;
+    }
+    int cmp = tree->base.compFunc(pivot, root->data);
+    // a child that was red gains a black node on every path once it's detached
+    int leftChildHeight = height - 1 + (root->left != NULL && root->left->color == RED);
+    int rightChildHeight = height - 1 + (root->right != NULL && root->right->color == RED);
+    Node *leftChild = detach(root->left);
+    Node *rightChild = detach(root->right);
+    if (cmp == 0)
+    {
+        *left = leftChild;
+        *right = rightChild;
+        *leftHeight = leftChildHeight;
+        *rightHeight = rightChildHeight;
+        root->left = NULL;
+        root->right = NULL;
+        root->parent = NULL;
+        if (tree->orderStatistics)
+        {
+            updateCount(root);
+        }
+        return root;
+    }
+    Node *found, *rest;
+    int restHeight;
+    if (cmp < 0)
+    {
+        found = extSplit(tree, leftChild, leftChildHeight, pivot, left, leftHeight, &rest, &restHeight);
+        *right = extJoin(tree, rest, restHeight, root, rightChild, rightChildHeight, rightHeight);
+    }
+    else
+    {
+        found = extSplit(tree, rightChild, rightChildHeight, pivot, &rest, &restHeight, right, rightHeight);
+        *left = extJoin(tree, leftChild, leftChildHeight, root, rest, restHeight, leftHeight);
+    }
+    return found;
+}
+
+Node *extJoin2(RBTreeEx *tree, Node *left, Node *right, int *height)
+{
+    if (left == NULL || right == NULL)
+    {
+        Node *root = detach(left != NULL ? left : right);
+        if (height != NULL)
+        {
+            *height = extBlackHeight(root);
+        }
+        return root;
+    }
+    // the greatest item of 'left' becomes the middle node. Unlinking it already costs O(log n), so measuring the
+    // heights here doesn't change the bound
+    RBTreeEx scratch = *tree;
+    scratch.base.root = detach(left);
+    Node *max = left;
+    while (max->right != NULL)
+    {
+        max = max->right;
+    }
+    extUnlinkNode(&scratch, max);
+    detach(scratch.base.root);
+    detach(right);
+    return extJoin(tree, scratch.base.root, extBlackHeight(scratch.base.root), max, right, extBlackHeight(right),
+                   height);
+}
+
+/**
+ * counts the nodes of whichever of the two subtrees is smaller, in O(log n + that count), by walking both in
+ * lockstep.
+ * @return: the count, with '*leftIsSmaller' telling which subtree it belongs to.
+ */
+static size_t countSmaller(Node *left, Node *right, int *leftIsSmaller)
+{
+    Node *cursors[2] = {left, right};
+    size_t counts[2] = {0, 0};
+    for (int i = 0; i < 2; i++)
+    {
+        while (cursors[i] != NULL && cursors[i]->left != NULL)
+        {
+            cursors[i] = cursors[i]->left;
+        }
+    }
+    while (cursors[0] != NULL && cursors[1] != NULL)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            Node *node = cursors[i];
+            counts[i]++;
+            if (node->right != NULL)
+            {
+                node = node->right;
+                while (node->left != NULL)
+                {
+                    node = node->left;
+                }
+            }
+            else
+            {
+                while (node->parent != NULL && node == node->parent->right)
+                {
+                    node = node->parent;
+                }
+                node = node->parent;
+            }
+            cursors[i] = node;
+        }
+    }
+    *leftIsSmaller = cursors[0] == NULL;
+    return *leftIsSmaller ? counts[0] : counts[1];
+}
+
+int splitRBTree(RBTreeEx *tree, const void *pivot, RBTreeEx **left, RBTreeEx **right)
+{
+    if (tree == NULL || pivot == NULL || left == NULL || right == NULL)
+    {
+        return 0;
+    }
+    RBTreeEx *greater = newRBTreeExLike(tree);
+    if (greater == NULL)
+    {
+        return 0;
+    }
+    Node *less, *more;
+    int lessHeight, moreHeight;
+    Node *equal = extSplit(tree, tree->base.root, extBlackHeight(tree->base.root), pivot, &less, &lessHeight, &more,
+                           &moreHeight);
+    if (equal != NULL)
+    {
+        // the item equal to the pivot goes to the right tree, as its smallest item
+        more = extJoin(tree, NULL, 0, equal, more, moreHeight, NULL);
+    }
+    int total = tree->base.size;
+    int lessCount;
+    if (tree->orderStatistics)
+    {
+        lessCount = (int) countOf(less);
+    }
+    else
+    {
+        int leftIsSmaller;
+        int smallerCount = (int) countSmaller(less, more, &leftIsSmaller);
+        lessCount = leftIsSmaller ? smallerCount : total - smallerCount;
+    }
+    tree->base.root = less;
+    tree->base.size = lessCount;
+    greater->base.root = more;
+    greater->base.size = total - lessCount;
+    *left = tree;
+    *right = greater;
+    return 1;
+}
+
+RBTreeEx *joinRBTree(RBTreeEx *left, RBTreeEx *right)
+{
+    if (left == NULL || right == NULL || left == right || left->base.compFunc != right->base.compFunc ||
+        left->base.freeFunc != right->base.freeFunc || !sameNodeKind(left, right) ||
+        left->base.size > INT_MAX - right->base.size)
+    {
+        return NULL;
+    }
+    if (right->base.root == NULL)
+    {
+        freeRBTreeEx(right);
+        return left;
+    }
+    Node *min = right->base.root;
+    while (min->left != NULL)
+    {
+        min = min->left;
+    }
+    if (left->base.root != NULL)
+    {
+        Node *max = left->base.root;
+        while (max->right != NULL)
+        {
+            max = max->right;
+        }
+        if (left->base.compFunc(max->data, min->data) >= 0)
+        {
+            return NULL;
+        }
+    }
+    // the smallest item of 'right' becomes the middle node of the join
+    extUnlinkNode(right, min);
+    left->base.root = extJoin(left, left->base.root, extBlackHeight(left->base.root), min, right->base.root,
+                              extBlackHeight(right->base.root), NULL);
+    left->base.size += right->base.size;
+    right->base.root = NULL;
+    freeRBTreeEx(right);
+    return left;
+}
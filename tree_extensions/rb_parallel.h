@@ -0,0 +1,118 @@
+#ifndef RB_PARALLEL_H
+#define RB_PARALLEL_H
+
+#include "rb_extensions.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Operations on whole trees that divide the work between several threads (see task_pool.h). Every operation takes
+ * the number of threads to use: 0 for one per CPU, 1 to run everything on the calling thread.
+ * The trees' CompareFunc and FreeFunc may be called from several threads at once.
+ */
+
+/**
+ * how set operations treat items that appear in both trees, and items that don't make it to the result.
+ */
+typedef struct RBSetPolicy
+{
+    /// on duplicates: 0 to keep the item of the first tree, other to keep the item of the second tree
+    int keepSecond;
+    /// other than 0 to call the FreeFunc (if any) of the tree an item came from on every item left out of the result
+    int freeDropped;
+    /// number of threads to use, 0 for one per CPU
+    unsigned int threads;
+} RBSetPolicy;
+
+/**
+ * the union of two trees: every item that is in either of them.
+ * the set operations are the join-based divide and conquer algorithms: the second tree's root splits the first
+ * tree, and the two halves are handled in parallel. They cost O(m log(n/m + 1)) work for trees of sizes m <= n, and
+ * polylogarithmic span.
+ * both trees must have the same CompareFunc and mode, and the same arena (or both have none) - see newRBTreeExLike.
+ * Their nodes are reused for the result, so no memory is allocated.
+ * @param first: the first tree. It is consumed: it becomes the result.
+ * @param second: the second tree. It is consumed: it is freed (without its items).
+ * @param policy: NULL for the defaults (keep the first tree's items, don't free dropped items, one thread per CPU).
+ * @return: the result, or NULL on failure (the trees are left unchanged).
+ */
+RBTreeEx *unionRBTree(RBTreeEx *first, RBTreeEx *second, const RBSetPolicy *policy);
+
+/**
+ * the intersection of two trees: every item that is in both of them. See unionRBTree.
+ */
+RBTreeEx *intersectRBTree(RBTreeEx *first, RBTreeEx *second, const RBSetPolicy *policy);
+
+/**
+ * the difference of two trees: every item of the first tree that isn't in the second one. See unionRBTree.
+ * ('keepSecond' has no effect, as no item of the second tree is kept)
+ */
+RBTreeEx *differenceRBTree(RBTreeEx *first, RBTreeEx *second, const RBSetPolicy *policy);
+
+/**
+ * the union of two trees, as a new tree: unlike unionRBTree, both trees are left as they are.
+ * the trees only need the same CompareFunc - they may have arenas of their own, different modes, or even come from
+ * RBTree.h. Their nodes are copied into the new tree (from its own arena, if it has one) and combined there the way
+ * unionRBTree combines them, so this costs an additional O(n + m) for the copies.
+ * the new tree shares its items with the two trees, so it has no FreeFunc: freeing it leaves the items alone.
+ * @param config: settings of the new tree, NULL for the defaults (no arena). It can't be intrusive, as the items'
+ * hooks are taken.
+ * @param policy: as for unionRBTree. 'freeDropped' has no effect, as no item leaves the two trees.
+ * @return: the new tree, or NULL on failure.
+ */
+RBTreeEx *newUnionRBTree(const RBTree *first, const RBTree *second, const RBTreeConfig *config,
+                         const RBSetPolicy *policy);
+
+/**
+ * the intersection of two trees, as a new tree. See newUnionRBTree.
+ */
+RBTreeEx *newIntersectionRBTree(const RBTree *first, const RBTree *second, const RBTreeConfig *config,
+                                const RBSetPolicy *policy);
+
+/**
+ * the difference of two trees, as a new tree. See newUnionRBTree.
+ */
+RBTreeEx *newDifferenceRBTree(const RBTree *first, const RBTree *second, const RBTreeConfig *config,
+                              const RBSetPolicy *policy);
+
+/**
+ * how reduceRBTree folds the items of a tree into a single value.
+ * an accumulator is a buffer of 'accumulatorSize' bytes holding the reduction of a run of consecutive items.
+ */
+typedef struct RBReducer
+{
+    /// size in bytes of an accumulator
+    size_t accumulatorSize;
+    /// 'accumulatorSize' bytes every accumulator starts as - the reduction of no items
+    const void *identity;
+    /// folds an item into an accumulator, as the item right after the ones already in it
+    void (*map)(const void *item, void *accumulator, void *args);
+    /// folds 'other' into 'accumulator', where the items of 'other' come right after the ones of 'accumulator'. Must be
+    /// associative
+    void (*combine)(void *accumulator, const void *other, void *args);
+    /// more optional arguments to 'map' and 'combine'
+    void *args;
+} RBReducer;
+
+/**
+ * reduce all the items of a tree to a single value, on several threads.
+ * the tree is cut into subtrees that are reduced in parallel, each one into its own accumulator (accumulators are
+ * allocated per worker thread and reused), and the results are combined in ascending order. Where the tree is cut
+ * depends only on its shape, so the result is the same whatever the number of threads - even for operations that are
+ * only approximately associative, such as adding floating point numbers.
+ * the tree is only read, so this works on any RBTree - as long as it isn't modified meanwhile.
+ * @param tree: the tree with all the items.
+ * @param reducer: the reduction.
+ * @param result: set to the reduction of all the items ('accumulatorSize' bytes).
+ * @param threads: number of threads to use, 0 for one per CPU.
+ * @return: 0 on failure, other on success.
+ */
+int reduceRBTree(const RBTree *tree, const RBReducer *reducer, void *result, unsigned int threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RB_PARALLEL_H
@@ -0,0 +1,316 @@
+#include "rb_persistent.h"
+#include <limits.h>
+#include <stdlib.h>
+
+// the height of a RB tree of at most INT_MAX items is below this
+#define MAX_HEIGHT (2 * 8 * sizeof(int))
+
+/**
+ * a node that may be shared between versions. Once shared it never changes, until it is freed.
+ */
+typedef struct PersistentNode
+{
+    struct PersistentNode *left, *right;
+    void *data;
+    Color color;
+    size_t references; // number of links (from nodes, the tree or snapshots) to this node, accessed atomically
+} PersistentNode;
+
+struct PersistentRBTree
+{
+    PersistentNode *root;
+    CompareFunc compFunc;
+    FreeFunc freeFunc;
+    int size;
+};
+
+struct RBSnapshot
+{
+    PersistentNode *root;
+    CompareFunc compFunc;
+    int size;
+};
+
+static void retain(PersistentNode *node)
+{
+    if (node != NULL)
+    {
+        __atomic_add_fetch(&node->references, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * drops a link to 'node', freeing it (and dropping its own links) if it was the last one.
+ */
+static void release(PersistentNode *node)
+{
+    if (node != NULL && __atomic_sub_fetch(&node->references, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+        release(node->left);
+        release(node->right);
+        free(node);
+    }
+}
+
+/**
+ * makes a link to 'node' exclusive, so the node may be changed: a node other links share is replaced (for this link
+ * only) by a copy of it.
+ * @return: the node to link to instead, or NULL on failure.
+ */
+static PersistentNode *own(PersistentNode *node)
+{
+    if (__atomic_load_n(&node->references, __ATOMIC_ACQUIRE) == 1)
+    {
+        return node;
+    }
+    PersistentNode *copy = (PersistentNode *) malloc(sizeof(PersistentNode));
+    if (copy == NULL)
+    {
+        return NULL;
+    }
+    *copy = *node;
+    copy->references = 1;
+    retain(copy->left);
+    retain(copy->right);
+    release(node);
+    return copy;
+}
+
+/**
+ * restores the RB properties below a black node, if one of its (owned) red children has a red child - by turning the
+ * three of them into a red node with two black children.
+ */
+static PersistentNode *balance(PersistentNode *node)
+{
+    if (node->color != BLACK)
+    {
+        return node;
+    }
+    PersistentNode *x, *y, *z, *a, *b, *c, *d;
+    PersistentNode *left = node->left, *right = node->right;
+    if (left != NULL && left->color == RED && left->left != NULL && left->left->color == RED)
+    {
+        x = left->left, y = left, z = node;
+        a = x->left, b = x->right, c = y->right, d = z->right;
+    }
+    else if (left != NULL && left->color == RED && left->right != NULL && left->right->color == RED)
+    {
+        x = left, y = left->right, z = node;
+        a = x->left, b = y->left, c = y->right, d = z->right;
+    }
+    else if (right != NULL && right->color == RED && right->left != NULL && right->left->color == RED)
+    {
+        x = node, y = right->left, z = right;
+        a = x->left, b = y->left, c = y->right, d = z->right;
+    }
+    else if (right != NULL && right->color == RED && right->right != NULL && right->right->color == RED)
+    {
+        x = node, y = right, z = right->right;
+        a = x->left, b = y->left, c = z->left, d = z->right;
+    }
+    else
+    {
+        return node;
+    }
+    x->left = a;
+    x->right = b;
+    x->color = BLACK;
+    z->left = c;
+    z->right = d;
+    z->color = BLACK;
+    y->left = x;
+    y->right = z;
+    y->color = RED;
+    return y;
+}
+
+/**
+ * inserts 'data' (known not to be in the subtree) into the subtree at '*link', owning every node on the way down.
+ * @return: 0 on failure (then the subtree is still valid, and still holds the same items, but some of its nodes may
+ * have been replaced by copies), other on success.
+ */
+static int insert(const PersistentRBTree *tree, PersistentNode **link, void *data)
+{
+    if (*link == NULL)
+    {
+        PersistentNode *leaf = (PersistentNode *) malloc(sizeof(PersistentNode));
+        if (leaf == NULL)
+        {
+            return 0;
+        }
+        leaf->left = NULL;
+        leaf->right = NULL;
+        leaf->data = data;
+        leaf->color = RED;
+        leaf->references = 1;
+        *link = leaf;
+        return 1;
+    }
+    PersistentNode *node = own(*link);
+    if (node == NULL)
+    {
+        return 0;
+    }
+    *link = node;
+    if (!insert(tree, tree->compFunc(data, node->data) < 0 ? &node->left : &node->right, data))
+    {
+        return 0;
+    }
+    *link = balance(node);
+    return 1;
+}
+
+static PersistentNode *find(PersistentNode *node, CompareFunc compFunc, const void *data)
+{
+    while (node != NULL)
+    {
+        int cmp = compFunc(data, node->data);
+        if (cmp == 0)
+        {
+            return node;
+        }
+        node = cmp < 0 ? node->left : node->right;
+    }
+    return NULL;
+}
+
+/**
+ * in-order walk with an explicit stack, as nodes have no parent link.
+ */
+static int forEachNode(PersistentNode *root, forEachFunc func, void *args)
+{
+    if (func == NULL)
+    {
+        return 0;
+    }
+    PersistentNode *stack[MAX_HEIGHT];
+    size_t depth = 0;
+    PersistentNode *node = root;
+    while (node != NULL || depth > 0)
+    {
+        while (node != NULL)
+        {
+            stack[depth++] = node;
+            node = node->left;
+        }
+        node = stack[--depth];
+        if (!func(node->data, args))
+        {
+            return 0;
+        }
+        node = node->right;
+    }
+    return 1;
+}
+
+PersistentRBTree *newPersistentRBTree(CompareFunc compFunc, FreeFunc freeFunc)
+{
+    if (compFunc == NULL)
+    {
+        return NULL;
+    }
+    PersistentRBTree *tree = (PersistentRBTree *) malloc(sizeof(PersistentRBTree));
+    if (tree == NULL)
+    {
+        return NULL;
+    }
+    tree->root = NULL;
+    tree->compFunc = compFunc;
+    tree->freeFunc = freeFunc;
+    tree->size = 0;
+    return tree;
+}
+
+int addToPersistentRBTree(PersistentRBTree *tree, void *data)
+{
+    if (tree == NULL || data == NULL || tree->size == INT_MAX || find(tree->root, tree->compFunc, data) != NULL)
+    {
+        return 0;
+    }
+    if (!insert(tree, &tree->root, data))
+    {
+        return 0;
+    }
+    // the root is owned by now, so it may be recolored
+    tree->root->color = BLACK;
+    tree->size++;
+    return 1;
+}
+
+int containsPersistentRBTree(const PersistentRBTree *tree, const void *data)
+{
+    return tree != NULL && data != NULL && find(tree->root, tree->compFunc, data) != NULL;
+}
+
+int forEachPersistentRBTree(const PersistentRBTree *tree, forEachFunc func, void *args)
+{
+    return tree != NULL && forEachNode(tree->root, func, args);
+}
+
+int sizeOfPersistentRBTree(const PersistentRBTree *tree)
+{
+    return tree != NULL ? tree->size : 0;
+}
+
+RBSnapshot *snapshotRBTree(PersistentRBTree *tree)
+{
+    if (tree == NULL)
+    {
+        return NULL;
+    }
+    RBSnapshot *snapshot = (RBSnapshot *) malloc(sizeof(RBSnapshot));
+    if (snapshot == NULL)
+    {
+        return NULL;
+    }
+    retain(tree->root);
+    snapshot->root = tree->root;
+    snapshot->compFunc = tree->compFunc;
+    snapshot->size = tree->size;
+    return snapshot;
+}
+
+int containsRBSnapshot(const RBSnapshot *snapshot, const void *data)
+{
+    return snapshot != NULL && data != NULL && find(snapshot->root, snapshot->compFunc, data) != NULL;
+}
+
+int forEachRBSnapshot(const RBSnapshot *snapshot, forEachFunc func, void *args)
+{
+    return snapshot != NULL && forEachNode(snapshot->root, func, args);
+}
+
+int sizeOfRBSnapshot(const RBSnapshot *snapshot)
+{
+    return snapshot != NULL ? snapshot->size : 0;
+}
+
+void releaseRBSnapshot(RBSnapshot *snapshot)
+{
+    if (snapshot == NULL)
+    {
+        return;
+    }
+    release(snapshot->root);
+    free(snapshot);
+}
+
+static int freeItem(const void *data, void *args)
+{
+    (*(FreeFunc *) args)((void *) data);
+    return 1;
+}
+
+void freePersistentRBTree(PersistentRBTree *tree)
+{
+    if (tree == NULL)
+    {
+        return;
+    }
+    if (tree->freeFunc != NULL)
+    {
+        forEachNode(tree->root, freeItem, &tree->freeFunc);
+    }
+    release(tree->root);
+    free(tree);
+}
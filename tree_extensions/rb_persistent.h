@@ -0,0 +1,102 @@
+#ifndef RB_PERSISTENT_H
+#define RB_PERSISTENT_H
+
+#include "RBTree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A RBTree whose older versions can be kept around as snapshots.
+ * nodes may be shared between versions, so they have no parent link. Every node counts the links to it, and adding
+ * an item copies only the nodes on the way down that are shared with some snapshot (O(log n) of them at most); a node
+ * only the current version links to is changed in place. So taking a snapshot costs O(1), and memory stays
+ * proportional to what the live versions hold.
+ * the tree itself must be used by one thread at a time, but snapshots are immutable: they may be read by any number
+ * of threads, and released by any thread, while the tree keeps changing.
+ */
+typedef struct PersistentRBTree PersistentRBTree;
+
+/**
+ * an immutable version of a PersistentRBTree.
+ */
+typedef struct RBSnapshot RBSnapshot;
+
+/**
+ * constructs a new, empty persistent tree.
+ * @param compFunc: a function two compare two variables.
+ * @param freeFunc: a function to free a data item, may be NULL.
+ * @return: the new tree, or NULL on failure.
+ */
+PersistentRBTree *newPersistentRBTree(CompareFunc compFunc, FreeFunc freeFunc);
+
+/**
+ * add an item to the tree, in O(log n). Snapshots taken before don't see it.
+ * @param tree: the tree to add an item to.
+ * @param data: item to add to the tree.
+ * @return: 0 on failure, other on success. (if the item is already in the tree - failure).
+ */
+int addToPersistentRBTree(PersistentRBTree *tree, void *data);
+
+/**
+ * check whether the tree contains this item.
+ * @return: 0 if the item is not in the tree, other if it is.
+ */
+int containsPersistentRBTree(const PersistentRBTree *tree, const void *data);
+
+/**
+ * Activate a function on each item of the tree, in ascending order. if one of the activations of the function
+ * returns 0, the process stops.
+ * @return: 0 on failure, other on success.
+ */
+int forEachPersistentRBTree(const PersistentRBTree *tree, forEachFunc func, void *args);
+
+/**
+ * @return: number of items in the tree.
+ */
+int sizeOfPersistentRBTree(const PersistentRBTree *tree);
+
+/**
+ * take a snapshot of the current version of the tree, in O(1).
+ * @param tree: the tree to take a snapshot of.
+ * @return: the snapshot, or NULL on failure. It must be released with releaseRBSnapshot.
+ */
+RBSnapshot *snapshotRBTree(PersistentRBTree *tree);
+
+/**
+ * check whether the snapshot contains this item.
+ * @return: 0 if the item is not in the snapshot, other if it is.
+ */
+int containsRBSnapshot(const RBSnapshot *snapshot, const void *data);
+
+/**
+ * Activate a function on each item of the snapshot, in ascending order. if one of the activations of the function
+ * returns 0, the process stops.
+ * @return: 0 on failure, other on success.
+ */
+int forEachRBSnapshot(const RBSnapshot *snapshot, forEachFunc func, void *args);
+
+/**
+ * @return: number of items in the snapshot.
+ */
+int sizeOfRBSnapshot(const RBSnapshot *snapshot);
+
+/**
+ * release a snapshot, freeing the nodes no other version holds. The items themselves belong to the tree.
+ * @param snapshot: the snapshot to release.
+ */
+void releaseRBSnapshot(RBSnapshot *snapshot);
+
+/**
+ * free the tree, calling its FreeFunc (if any) on every item. Snapshots that weren't released yet keep their nodes,
+ * but their items are gone - so they may only be released afterwards.
+ * @param tree: the tree to free.
+ */
+void freePersistentRBTree(PersistentRBTree *tree);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RB_PERSISTENT_H
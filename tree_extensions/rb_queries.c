@@ -0,0 +1,383 @@
+#include "rb_queries.h"
+#include <stddef.h>
+
+/**
+ * @return: the node following 'node' in ascending order, or NULL if it is the last one.
+ */
+static Node *successorOf(const Node *node)
+{
+    if (node->right != NULL)
+    {
+        Node *next = node->right;
+        while (next->left != NULL)
+        {
+            next = next->left;
+        }
+        return next;
+    }
+    while (node->parent != NULL && node == node->parent->right)
+    {
+        node = node->parent;
+    }
+    return node->parent;
+}
+
+/**
+ * @return: the node preceding 'node' in ascending order, or NULL if it is the first one.
+ */
+static Node *predecessorOf(const Node *node)
+{
+    if (node->left != NULL)
+    {
+        Node *previous = node->left;
+        while (previous->right != NULL)
+        {
+            previous = previous->right;
+        }
+        return previous;
+    }
+    while (node->parent != NULL && node == node->parent->left)
+    {
+        node = node->parent;
+    }
+    return node->parent;
+}
+
+/**
+ * finds, in a single descent, the nodes around 'probe'.
+ * @param below: set to the node of the greatest item smaller than 'probe', or NULL.
+ * @param equal: set to the node of the item equal to 'probe', or NULL.
+ * @param above: set to the node of the smallest item greater than 'probe', or NULL.
+ */
+static void findAround(const RBTree *tree, const void *probe, Node **below, Node **equal, Node **above)
+{
+    *below = NULL;
+    *equal = NULL;
+    *above = NULL;
+    Node *node = tree->root;
+    while (node != NULL)
+    {
+        int cmp = tree->compFunc(probe, node->data);
+        if (cmp > 0)
+        {
+            *below = node;
+            node = node->right;
+        }
+        else if (cmp < 0)
+        {
+            *above = node;
+            node = node->left;
+        }
+        else
+        {
+            // the neighbours of an exact match are the extremes of its subtrees, if it has them
+            *equal = node;
+            if (node->left != NULL)
+            {
+                Node *max = node->left;
+                while (max->right != NULL)
+                {
+                    max = max->right;
+                }
+                *below = max;
+            }
+            if (node->right != NULL)
+            {
+                Node *min = node->right;
+                while (min->left != NULL)
+                {
+                    min = min->left;
+                }
+                *above = min;
+            }
+            return;
+        }
+    }
+}
+
+int forEachRangeRBTree(const RBTree *tree, const void *low, int lowInclusive, const void *high, int highInclusive,
+                       forEachFunc func, void *args)
+{
+    if (tree == NULL || func == NULL)
+    {
+        return 0;
+    }
+    Node *node;
+    if (low != NULL)
+    {
+        Node *below, *equal;
+        findAround(tree, low, &below, &equal, &node);
+        if (equal != NULL && lowInclusive)
+        {
+            node = equal;
+        }
+    }
+    else if ((node = tree->root) != NULL)
+    {
+        while (node->left != NULL)
+        {
+            node = node->left;
+        }
+    }
+    while (node != NULL)
+    {
+        if (high != NULL)
+        {
+            int cmp = tree->compFunc(high, node->data);
+            if (cmp < 0 || (cmp == 0 && !highInclusive))
+            {
+                break;
+            }
+        }
+        if (!func(node->data, args))
+        {
+            return 0;
+        }
+        node = successorOf(node);
+    }
+    return 1;
+}
+
+int neighborsRBTree(const RBTree *tree, const void *probe, RBNeighbors *neighbors)
+{
+    if (tree == NULL || probe == NULL || neighbors == NULL)
+    {
+        return 0;
+    }
+    Node *below, *equal, *above;
+    findAround(tree, probe, &below, &equal, &above);
+    neighbors->predecessor = below != NULL ? below->data : NULL;
+    neighbors->successor = above != NULL ? above->data : NULL;
+    neighbors->floor = equal != NULL ? equal->data : neighbors->predecessor;
+    neighbors->ceiling = equal != NULL ? equal->data : neighbors->successor;
+    return equal != NULL;
+}
+
+void *floorRBTree(const RBTree *tree, const void *probe)
+{
+    RBNeighbors neighbors = {NULL, NULL, NULL, NULL};
+    neighborsRBTree(tree, probe, &neighbors);
+    return neighbors.floor;
+}
+
+void *ceilingRBTree(const RBTree *tree, const void *probe)
+{
+    RBNeighbors neighbors = {NULL, NULL, NULL, NULL};
+    neighborsRBTree(tree, probe, &neighbors);
+    return neighbors.ceiling;
+}
+
+void *predecessorRBTree(const RBTree *tree, const void *probe)
+{
+    RBNeighbors neighbors = {NULL, NULL, NULL, NULL};
+    neighborsRBTree(tree, probe, &neighbors);
+    return neighbors.predecessor;
+}
+
+void *successorRBTree(const RBTree *tree, const void *probe)
+{
+    RBNeighbors neighbors = {NULL, NULL, NULL, NULL};
+    neighborsRBTree(tree, probe, &neighbors);
+    return neighbors.successor;
+}
+
+// lookups in flight at once. Enough to cover a memory access with the work of the others
+#define LOOKUP_LANES (16)
+
+/**
+ * one lookup in flight: the next node it looks at, and whether that node's item was already prefetched.
+ */
+typedef struct LookupLane
+{
+    const Node *node; // NULL once there are no more probes for this lane
+    size_t probe;
+    int itemRequested;
+} LookupLane;
+
+/**
+ * @return: the index of the next non-NULL probe from *next on (or n if there's none), marking NULL probes not found.
+ */
+static size_t takeProbe(void *const *probes, size_t n, int *out, size_t *next)
+{
+    while (*next < n && probes[*next] == NULL)
+    {
+        out[(*next)++] = 0;
+    }
+    return *next < n ? (*next)++ : n;
+}
+
+/**
+ * looks up sorted probes by walking the tree in order alongside them. The probes are never compared with each other
+ * (they may not even be of a type the CompareFunc takes as its second argument): a probe that isn't greater than the
+ * last item the walk passed shows they aren't sorted.
+ * @return: the number of probes looked up - less than n if the probe at that index is out of order.
+ */
+static size_t mergeProbes(const RBTree *tree, void *const *probes, size_t n, int *out)
+{
+    const Node *node = tree->root;
+    while (node != NULL && node->left != NULL)
+    {
+        node = node->left;
+    }
+    const Node *passed = NULL; // the node right before 'node' in order
+    for (size_t i = 0; i < n; i++)
+    {
+        if (probes[i] == NULL)
+        {
+            out[i] = 0;
+            continue;
+        }
+        int cmp = 1, advanced = 0;
+        while (node != NULL && (cmp = tree->compFunc(probes[i], node->data)) > 0)
+        {
+            passed = node;
+            node = successorOf(node);
+            advanced = 1;
+        }
+        if (!advanced && passed != NULL && tree->compFunc(probes[i], passed->data) <= 0)
+        {
+            return i;
+        }
+        out[i] = node != NULL && cmp == 0;
+    }
+    return n;
+}
+
+int containsManyRBTree(const RBTree *tree, void *const *probes, size_t n, int *out)
+{
+    if (tree == NULL || tree->compFunc == NULL || (n > 0 && (probes == NULL || out == NULL)))
+    {
+        return 0;
+    }
+    // a merge costs O(n + m) against O(n log m) for separate lookups. If the probes turn out not to be sorted, the
+    // rest of them are looked up separately, having wasted at most the O(m) of one walk
+    size_t logSize = 0;
+    while (((size_t) 1 << logSize) <= (size_t) tree->size)
+    {
+        logSize++;
+    }
+    if (tree->root == NULL || n * logSize >= (size_t) tree->size)
+    {
+        size_t merged = mergeProbes(tree, probes, n, out);
+        probes += merged;
+        out += merged;
+        n -= merged;
+    }
+
+    LookupLane lanes[LOOKUP_LANES];
+    size_t next = 0;
+    int active = 0;
+    for (int i = 0; i < LOOKUP_LANES; i++)
+    {
+        lanes[i].probe = takeProbe(probes, n, out, &next);
+        lanes[i].node = lanes[i].probe < n ? tree->root : NULL;
+        lanes[i].itemRequested = 0;
+        active += lanes[i].node != NULL;
+    }
+    __builtin_prefetch(tree->root);
+    // every turn moves each lane one step: either its node arrived and it requests the node's item, or the item
+    // arrived and it compares, moving on to a child (or to a new probe)
+    while (active > 0)
+    {
+        for (int i = 0; i < LOOKUP_LANES; i++)
+        {
+            LookupLane *lane = &lanes[i];
+            if (lane->node == NULL)
+            {
+                continue;
+            }
+            if (!lane->itemRequested)
+            {
+                __builtin_prefetch(lane->node->data);
+                lane->itemRequested = 1;
+                continue;
+            }
+            int cmp = tree->compFunc(probes[lane->probe], lane->node->data);
+            const Node *child = cmp < 0 ? lane->node->left : lane->node->right;
+            if (cmp == 0 || child == NULL)
+            {
+                out[lane->probe] = cmp == 0;
+                lane->probe = takeProbe(probes, n, out, &next);
+                child = lane->probe < n ? tree->root : NULL;
+                active -= child == NULL;
+            }
+            lane->node = child;
+            lane->itemRequested = 0;
+            if (child != NULL)
+            {
+                __builtin_prefetch(child);
+            }
+        }
+    }
+    return 1;
+}
+
+/**
+ * points 'iterator' at 'node' and returns its item
+ */
+static void *moveTo(RBIterator *iterator, Node *node)
+{
+    iterator->node = node;
+    return node != NULL ? node->data : NULL;
+}
+
+void *firstRBTree(const RBTree *tree, RBIterator *iterator)
+{
+    if (iterator == NULL)
+    {
+        return NULL;
+    }
+    Node *node = tree != NULL ? tree->root : NULL;
+    while (node != NULL && node->left != NULL)
+    {
+        node = node->left;
+    }
+    return moveTo(iterator, node);
+}
+
+void *lastRBTree(const RBTree *tree, RBIterator *iterator)
+{
+    if (iterator == NULL)
+    {
+        return NULL;
+    }
+    Node *node = tree != NULL ? tree->root : NULL;
+    while (node != NULL && node->right != NULL)
+    {
+        node = node->right;
+    }
+    return moveTo(iterator, node);
+}
+
+void *seekRBTree(const RBTree *tree, const void *probe, RBIterator *iterator)
+{
+    if (iterator == NULL)
+    {
+        return NULL;
+    }
+    if (tree == NULL || probe == NULL)
+    {
+        return moveTo(iterator, NULL);
+    }
+    Node *below, *equal, *above;
+    findAround(tree, probe, &below, &equal, &above);
+    return moveTo(iterator, equal != NULL ? equal : above);
+}
+
+void *nextRBTree(RBIterator *iterator)
+{
+    if (iterator == NULL || iterator->node == NULL)
+    {
+        return NULL;
+    }
+    return moveTo(iterator, successorOf(iterator->node));
+}
+
+void *prevRBTree(RBIterator *iterator)
+{
+    if (iterator == NULL || iterator->node == NULL)
+    {
+        return NULL;
+    }
+    return moveTo(iterator, predecessorOf(iterator->node));
+}
@@ -0,0 +1,134 @@
+#ifndef RB_QUERIES_H
+#define RB_QUERIES_H
+
+#include <stddef.h>
+#include "RBTree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Read-only queries. These only follow the links of the tree's nodes (including 'parent'), so they work on any
+ * RBTree - one built by RBTree.c, by the school solution, or the 'base' of a RBTreeEx.
+ * Probes and bounds are always passed to the tree's CompareFunc first, and a stored item second - like the search of
+ * RBTree.c does - so a probe may be of another type than the items (e.g. a name, looked up in a tree of products),
+ * as long as the CompareFunc expects that.
+ */
+
+/**
+ * Activate a function on each item of the tree within a range, in ascending order. if one of the activations of the
+ * function returns 0, the process stops. Costs O(log n + k) where k is the number of items in the range.
+ * @param tree: the tree with all the items.
+ * @param low: lower bound of the range, compared with the tree's CompareFunc. NULL for no lower bound.
+ * @param lowInclusive: other than 0 if an item equal to 'low' is in the range.
+ * @param high: upper bound of the range. NULL for no upper bound.
+ * @param highInclusive: other than 0 if an item equal to 'high' is in the range.
+ * @param func: the function to activate on the items.
+ * @param args: more optional arguments to the function (may be null if the given function support it).
+ * @return: 0 on failure, other on success.
+ */
+int forEachRangeRBTree(const RBTree *tree, const void *low, int lowInclusive, const void *high, int highInclusive,
+                       forEachFunc func, void *args);
+
+/**
+ * the stored items nearest to a probe.
+ * each of them is NULL if there's no such item in the tree.
+ */
+typedef struct RBNeighbors
+{
+    void *floor;       // greatest item <= probe
+    void *ceiling;     // smallest item >= probe (a.k.a lower_bound)
+    void *predecessor; // greatest item < probe
+    void *successor;   // smallest item > probe (a.k.a upper_bound)
+} RBNeighbors;
+
+/**
+ * finds the items nearest to 'probe' in a single O(log n) descent.
+ * @param tree: the tree to search.
+ * @param probe: an item to compare with the tree's items. It doesn't have to be in the tree.
+ * @param neighbors: filled with the items found.
+ * @return: 0 if no item equal to 'probe' is in the tree (or on failure), other if there is.
+ */
+int neighborsRBTree(const RBTree *tree, const void *probe, RBNeighbors *neighbors);
+
+/**
+ * @return: the greatest item <= probe, or NULL if there's none.
+ */
+void *floorRBTree(const RBTree *tree, const void *probe);
+
+/**
+ * @return: the smallest item >= probe, or NULL if there's none.
+ */
+void *ceilingRBTree(const RBTree *tree, const void *probe);
+
+/**
+ * @return: the greatest item < probe, or NULL if there's none.
+ */
+void *predecessorRBTree(const RBTree *tree, const void *probe);
+
+/**
+ * @return: the smallest item > probe, or NULL if there's none.
+ */
+void *successorRBTree(const RBTree *tree, const void *probe);
+
+/**
+ * looks up a batch of probes at once, like calling containsRBTree on each.
+ * a single lookup spends most of its time waiting for the next node to arrive from memory. Here several lookups
+ * advance in turns instead: each one prefetches the node (and then the item) it needs next, and waits for it while
+ * the others make progress. If the probes happen to be sorted and there are enough of them, they're rather merged
+ * with one in-order walk of the tree, in O(n + m). Probes are only ever compared with items, never with each other.
+ * @param tree: the tree to search.
+ * @param probes: the items to look for. NULL probes are never found.
+ * @param n: number of probes.
+ * @param out: out[i] is set to other than 0 if probes[i] is in the tree, and to 0 if it isn't.
+ * @return: 0 on failure, other on success.
+ */
+int containsManyRBTree(const RBTree *tree, void *const *probes, size_t n, int *out);
+
+/**
+ * a position within a tree, for walking it in either direction one item at a time.
+ * it needs no memory besides itself - steps follow the nodes' parent links, costing amortised O(1) each.
+ * the iterator is invalidated if the node it points to is removed from the tree. Other changes to the tree don't
+ * invalidate it, but may change which items come before or after it.
+ */
+typedef struct RBIterator
+{
+    Node *node; // the node at the current position, NULL once the iterator walked past either end
+} RBIterator;
+
+/**
+ * moves the iterator to the smallest item of the tree.
+ * @return: the item, or NULL if the tree is empty.
+ */
+void *firstRBTree(const RBTree *tree, RBIterator *iterator);
+
+/**
+ * moves the iterator to the greatest item of the tree.
+ * @return: the item, or NULL if the tree is empty.
+ */
+void *lastRBTree(const RBTree *tree, RBIterator *iterator);
+
+/**
+ * moves the iterator to the smallest item >= probe, in O(log n).
+ * @return: the item, or NULL if there's none.
+ */
+void *seekRBTree(const RBTree *tree, const void *probe, RBIterator *iterator);
+
+/**
+ * moves the iterator to the next item in ascending order.
+ * @return: the item, or NULL if the iterator was at the last item (or already past either end).
+ */
+void *nextRBTree(RBIterator *iterator);
+
+/**
+ * moves the iterator to the previous item in ascending order.
+ * @return: the item, or NULL if the iterator was at the first item (or already past either end).
+ */
+void *prevRBTree(RBIterator *iterator);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RB_QUERIES_H
@@ -0,0 +1,192 @@
+#include "rb_parallel.h"
+#include "rb_internal.h"
+#include "task_pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct ReduceContext
+{
+    const RBReducer *reducer;
+    size_t bufferSize; // an accumulator, and large enough to link it into a free list
+    void **spare;      // per worker: accumulators that were combined already, linked through their first bytes
+    int failed;        // set (atomically) if an accumulator couldn't be allocated
+} ReduceContext;
+
+typedef struct ReduceTask
+{
+    Task task;
+    ReduceContext *context;
+    const Node *root;
+    int height;        // black height of 'root'
+    void *accumulator; // starts as the identity, and ends as the reduction of the subtree
+} ReduceTask;
+
+/**
+ * @return: an accumulator holding the identity, or NULL on failure.
+ */
+static void *takeAccumulator(ReduceContext *context, unsigned int worker)
+{
+    void *accumulator = context->spare[worker];
+    if (accumulator != NULL)
+    {
+        context->spare[worker] = *(void **) accumulator;
+    }
+    else if ((accumulator = malloc(context->bufferSize)) == NULL)
+    {
+        return NULL;
+    }
+    memcpy(accumulator, context->reducer->identity, context->reducer->accumulatorSize);
+    return accumulator;
+}
+
+static void giveAccumulator(ReduceContext *context, unsigned int worker, void *accumulator)
+{
+    *(void **) accumulator = context->spare[worker];
+    context->spare[worker] = accumulator;
+}
+
+/**
+ * maps the items of a subtree into 'accumulator' in ascending order, without leaving the subtree.
+ */
+static void foldSubtree(const Node *root, const RBReducer *reducer, void *accumulator)
+{
+    if (root == NULL)
+    {
+        return;
+    }
+    const Node *node = root;
+    while (node->left != NULL)
+    {
+        node = node->left;
+    }
+    while (1)
+    {
+        reducer->map(node->data, accumulator, reducer->args);
+        if (node->right != NULL)
+        {
+            node = node->right;
+            while (node->left != NULL)
+            {
+                node = node->left;
+            }
+            continue;
+        }
+        // climb until coming up from a left child - or back to the root, which means its right subtree is done
+        while (node != root && node == node->parent->right)
+        {
+            node = node->parent;
+        }
+        if (node == root)
+        {
+            return;
+        }
+        node = node->parent;
+    }
+}
+
+static void runReduceTask(Task *task, TaskWorker *worker);
+
+static void initReduceTask(ReduceTask *job, ReduceContext *context, const Node *root, int height, void *accumulator)
+{
+    job->task.func = runReduceTask;
+    job->task.done = 0;
+    job->context = context;
+    job->root = root;
+    job->height = height;
+    job->accumulator = accumulator;
+}
+
+/**
+ * @param worker: the pool thread running the task, or NULL to run it (and all its sub tasks) sequentially - which
+ * still cuts the tree at the same places, so the result is the same.
+ */
+static void reduceSubtree(ReduceTask *job, TaskWorker *worker)
+{
+    ReduceContext *context = job->context;
+    const RBReducer *reducer = context->reducer;
+    const Node *root = job->root;
+    if (root == NULL || job->height < EXT_FORK_HEIGHT)
+    {
+        foldSubtree(root, reducer, job->accumulator);
+        return;
+    }
+    unsigned int index = worker != NULL ? taskWorkerIndex(worker) : 0;
+    void *rightAccumulator = takeAccumulator(context, index);
+    if (rightAccumulator == NULL)
+    {
+        __atomic_store_n(&context->failed, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    int childHeight = job->height - (root->color == BLACK);
+    ReduceTask left, right;
+    initReduceTask(&left, context, root->left, childHeight, job->accumulator);
+    initReduceTask(&right, context, root->right, childHeight, rightAccumulator);
+    if (worker != NULL)
+    {
+        taskFork(worker, &left.task);
+        reduceSubtree(&right, worker);
+        taskJoin(worker, &left.task);
+    }
+    else
+    {
+        reduceSubtree(&left, NULL);
+        reduceSubtree(&right, NULL);
+    }
+    reducer->map(root->data, job->accumulator, reducer->args);
+    reducer->combine(job->accumulator, rightAccumulator, reducer->args);
+    giveAccumulator(context, index, rightAccumulator);
+}
+
+static void runReduceTask(Task *task, TaskWorker *worker)
+{
+    reduceSubtree((ReduceTask *) task, worker);
+}
+
+int reduceRBTree(const RBTree *tree, const RBReducer *reducer, void *result, unsigned int threads)
+{
+    if (tree == NULL || reducer == NULL || reducer->map == NULL || reducer->combine == NULL || result == NULL ||
+        (reducer->identity == NULL && reducer->accumulatorSize > 0))
+    {
+        return 0;
+    }
+    memcpy(result, reducer->identity, reducer->accumulatorSize);
+    ReduceContext context;
+    context.reducer = reducer;
+    context.bufferSize = reducer->accumulatorSize > sizeof(void *) ? reducer->accumulatorSize : sizeof(void *);
+    context.failed = 0;
+    ReduceTask job;
+    initReduceTask(&job, &context, tree->root, extBlackHeight(tree->root), result);
+    // if a pool can't be started the reduction still succeeds, on the calling thread alone
+    TaskPool *pool = NULL;
+    if (threads != 1 && job.height >= EXT_FORK_HEIGHT)
+    {
+        pool = newTaskPool(threads);
+    }
+    unsigned int workers = pool != NULL ? taskPoolThreads(pool) : 1;
+    context.spare = (void **) calloc(workers, sizeof(void *));
+    if (context.spare == NULL)
+    {
+        freeTaskPool(pool);
+        return 0;
+    }
+    if (pool != NULL)
+    {
+        taskPoolRun(pool, &job.task);
+        freeTaskPool(pool);
+    }
+    else
+    {
+        reduceSubtree(&job, NULL);
+    }
+    for (unsigned int i = 0; i < workers; i++)
+    {
+        while (context.spare[i] != NULL)
+        {
+            void *next = *(void **) context.spare[i];
+            free(context.spare[i]);
+            context.spare[i] = next;
+        }
+    }
+    free(context.spare);
+    return !context.failed;
+}
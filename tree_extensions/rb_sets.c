@@ -0,0 +1,350 @@
+#include "rb_parallel.h"
+#include "rb_internal.h"
+#include "task_pool.h"
+#include <limits.h>
+#include <stdlib.h>
+
+typedef enum SetOperation
+{
+    UNION,
+    INTERSECTION,
+    DIFFERENCE
+} SetOperation;
+
+/**
+ * subtrees left out of a result, linked through the parent pointers of their roots.
+ */
+typedef struct DropList
+{
+    Node *head, *tail;
+} DropList;
+
+typedef struct SetContext
+{
+    RBTreeEx *tree; // for the CompareFunc and mode, never modified during the operation
+    SetOperation operation;
+    int keepSecond;
+} SetContext;
+
+/**
+ * one recursive call of a set operation, on a subtree of each tree.
+ */
+typedef struct SetTask
+{
+    Task task;
+    const SetContext *context;
+    Node *first, *second;
+    int firstHeight, secondHeight; // black heights, counting the roots as black
+    Node *result;
+    int resultHeight;
+    size_t matches;                // items found in both subtrees
+    DropList droppedFirst, droppedSecond;
+} SetTask;
+
+static void drop(DropList *list, Node *root)
+{
+    if (root == NULL)
+    {
+        return;
+    }
+    root->parent = NULL;
+    if (list->tail != NULL)
+    {
+        list->tail->parent = root;
+    }
+    else
+    {
+        list->head = root;
+    }
+    list->tail = root;
+}
+
+static void appendDropped(DropList *list, const DropList *other)
+{
+    if (other->head == NULL)
+    {
+        return;
+    }
+    if (list->tail != NULL)
+    {
+        list->tail->parent = other->head;
+    }
+    else
+    {
+        list->head = other->head;
+    }
+    list->tail = other->tail;
+}
+
+static void runSetTask(Task *task, TaskWorker *worker);
+
+static void initSetTask(SetTask *job, const SetContext *context, Node *first, int firstHeight, Node *second,
+                        int secondHeight)
+{
+    job->task.func = runSetTask;
+    job->task.done = 0;
+    job->context = context;
+    job->first = first;
+    job->second = second;
+    job->firstHeight = firstHeight;
+    job->secondHeight = secondHeight;
+    job->result = NULL;
+    job->resultHeight = 0;
+    job->matches = 0;
+    job->droppedFirst.head = job->droppedFirst.tail = NULL;
+    job->droppedSecond.head = job->droppedSecond.tail = NULL;
+}
+
+/**
+ * @param worker: the pool thread running the task, or NULL to run it (and all its sub tasks) sequentially.
+ */
+static void setOperation(SetTask *job, TaskWorker *worker)
+{
+    const SetContext *context = job->context;
+    Node *first = job->first, *second = job->second;
+    if (first == NULL || second == NULL)
+    {
+        switch (context->operation)
+        {
+            case UNION:
+                job->result = first != NULL ? first : second;
+                job->resultHeight = first != NULL ? job->firstHeight : job->secondHeight;
+                break;
+            case INTERSECTION:
+                drop(&job->droppedFirst, first);
+                drop(&job->droppedSecond, second);
+                break;
+            case DIFFERENCE:
+                job->result = first;
+                job->resultHeight = job->firstHeight;
+                drop(&job->droppedSecond, second);
+                break;
+        }
+        return;
+    }
+    // the root of the second subtree splits the first one, and each side is handled on its own
+    Node *firstLeft, *firstRight;
+    int firstLeftHeight, firstRightHeight;
+    Node *equal = extSplit(context->tree, first, job->firstHeight, second->data, &firstLeft, &firstLeftHeight,
+                           &firstRight, &firstRightHeight);
+    int childHeight = job->secondHeight - 1;
+    Node *secondLeft = second->left, *secondRight = second->right;
+    second->left = NULL;
+    second->right = NULL;
+    SetTask left, right;
+    initSetTask(&left, context, firstLeft, firstLeftHeight, secondLeft,
+                childHeight + (secondLeft != NULL && secondLeft->color == RED));
+    initSetTask(&right, context, firstRight, firstRightHeight, secondRight,
+                childHeight + (secondRight != NULL && secondRight->color == RED));
+    if (worker != NULL && job->secondHeight >= EXT_FORK_HEIGHT)
+    {
+        taskFork(worker, &left.task);
+        setOperation(&right, worker);
+        taskJoin(worker, &left.task);
+    }
+    else
+    {
+        setOperation(&left, worker);
+        setOperation(&right, worker);
+    }
+    job->matches = left.matches + right.matches + (equal != NULL);
+    job->droppedFirst = left.droppedFirst;
+    job->droppedSecond = left.droppedSecond;
+    appendDropped(&job->droppedFirst, &right.droppedFirst);
+    appendDropped(&job->droppedSecond, &right.droppedSecond);
+
+    Node *kept = NULL;
+    if (equal != NULL && context->operation != DIFFERENCE)
+    {
+        if (context->keepSecond)
+        {
+            kept = second;
+            drop(&job->droppedFirst, equal);
+        }
+        else
+        {
+            kept = equal;
+            drop(&job->droppedSecond, second);
+        }
+    }
+    else if (context->operation == UNION)
+    {
+        kept = second;
+    }
+    else
+    {
+        drop(&job->droppedFirst, equal);
+        drop(&job->droppedSecond, second);
+    }
+    job->result = kept != NULL ? extJoin(context->tree, left.result, left.resultHeight, kept, right.result,
+                                         right.resultHeight, &job->resultHeight)
+                               : extJoin2(context->tree, left.result, right.result, &job->resultHeight);
+}
+
+static void runSetTask(Task *task, TaskWorker *worker)
+{
+    setOperation((SetTask *) task, worker);
+}
+
+static void releaseDropped(RBTreeEx *tree, const DropList *list, FreeFunc freeFunc)
+{
+    Node *root = list->head;
+    while (root != NULL)
+    {
+        Node *next = root == list->tail ? NULL : root->parent;
+        root->parent = NULL;
+        extReleaseSubtree(tree, root, freeFunc, 1);
+        root = next;
+    }
+}
+
+static RBTreeEx *setOperationRBTree(RBTreeEx *first, RBTreeEx *second, const RBSetPolicy *policy,
+                                    SetOperation operation)
+{
+    if (first == NULL || second == NULL || first == second || first->base.compFunc != second->base.compFunc ||
+        !sameNodeKind(first, second) ||
+        (operation == UNION && first->base.size > INT_MAX - second->base.size))
+    {
+        return NULL;
+    }
+    RBSetPolicy defaults = {0, 0, 0};
+    if (policy == NULL)
+    {
+        policy = &defaults;
+    }
+    SetContext context = {first, operation, policy->keepSecond};
+    SetTask job;
+    initSetTask(&job, &context, first->base.root, extBlackHeight(first->base.root), second->base.root,
+                extBlackHeight(second->base.root));
+    // if a pool can't be started the operation still succeeds, on the calling thread alone
+    TaskPool *pool = NULL;
+    if (policy->threads != 1 && job.secondHeight >= EXT_FORK_HEIGHT)
+    {
+        pool = newTaskPool(policy->threads);
+    }
+    if (pool != NULL)
+    {
+        taskPoolRun(pool, &job.task);
+        freeTaskPool(pool);
+    }
+    else
+    {
+        setOperation(&job, NULL);
+    }
+    if (job.result != NULL)
+    {
+        job.result->parent = NULL;
+        job.result->color = BLACK;
+    }
+
+    releaseDropped(first, &job.droppedFirst, policy->freeDropped ? first->base.freeFunc : NULL);
+    releaseDropped(first, &job.droppedSecond, policy->freeDropped ? second->base.freeFunc : NULL);
+    int matches = (int) job.matches;
+    switch (operation)
+    {
+        case UNION:
+            first->base.size += second->base.size - matches;
+            break;
+        case INTERSECTION:
+            first->base.size = matches;
+            break;
+        case DIFFERENCE:
+            first->base.size -= matches;
+            break;
+    }
+    first->base.root = job.result;
+    second->base.root = NULL;
+    second->base.size = 0;
+    freeRBTreeEx(second);
+    return first;
+}
+
+RBTreeEx *unionRBTree(RBTreeEx *first, RBTreeEx *second, const RBSetPolicy *policy)
+{
+    return setOperationRBTree(first, second, policy, UNION);
+}
+
+RBTreeEx *intersectRBTree(RBTreeEx *first, RBTreeEx *second, const RBSetPolicy *policy)
+{
+    return setOperationRBTree(first, second, policy, INTERSECTION);
+}
+
+RBTreeEx *differenceRBTree(RBTreeEx *first, RBTreeEx *second, const RBSetPolicy *policy)
+{
+    return setOperationRBTree(first, second, policy, DIFFERENCE);
+}
+
+/**
+ * copies the nodes of a subtree (not its items) into 'tree', keeping its shape and colors.
+ * @return: 0 on failure (leaving a partial copy, linked at 'link'), other on success.
+ */
+static int copySubtree(RBTreeEx *tree, const Node *source, Node *parent, Node **link)
+{
+    *link = NULL;
+    if (source == NULL)
+    {
+        return 1;
+    }
+    Node *node = extAllocNode(tree, source->data);
+    if (node == NULL)
+    {
+        return 0;
+    }
+    node->parent = parent;
+    node->left = NULL;
+    node->right = NULL;
+    node->color = source->color;
+    node->data = source->data;
+    *link = node;
+    if (!copySubtree(tree, source->left, node, &node->left) || !copySubtree(tree, source->right, node, &node->right))
+    {
+        return 0;
+    }
+    if (tree->orderStatistics)
+    {
+        updateCount(node);
+    }
+    return 1;
+}
+
+static RBTreeEx *newSetOperationRBTree(const RBTree *first, const RBTree *second, const RBTreeConfig *config,
+                                       const RBSetPolicy *policy, SetOperation operation)
+{
+    if (first == NULL || second == NULL || first->compFunc != second->compFunc ||
+        (config != NULL && config->intrusive) ||
+        (operation == UNION && first->size > INT_MAX - second->size))
+    {
+        return NULL;
+    }
+    // both copies come from the result's arena, so the operation can move nodes between them
+    RBTreeEx *copy = newRBTreeEx(first->compFunc, NULL, config);
+    RBTreeEx *otherCopy = newRBTreeExLike(copy);
+    if (copy == NULL || otherCopy == NULL || !copySubtree(copy, first->root, NULL, &copy->base.root) ||
+        !copySubtree(otherCopy, second->root, NULL, &otherCopy->base.root))
+    {
+        freeRBTreeEx(copy);
+        freeRBTreeEx(otherCopy);
+        return NULL;
+    }
+    copy->base.size = first->size;
+    otherCopy->base.size = second->size;
+    return setOperationRBTree(copy, otherCopy, policy, operation);
+}
+
+RBTreeEx *newUnionRBTree(const RBTree *first, const RBTree *second, const RBTreeConfig *config,
+                         const RBSetPolicy *policy)
+{
+    return newSetOperationRBTree(first, second, config, policy, UNION);
+}
+
+RBTreeEx *newIntersectionRBTree(const RBTree *first, const RBTree *second, const RBTreeConfig *config,
+                                const RBSetPolicy *policy)
+{
+    return newSetOperationRBTree(first, second, config, policy, INTERSECTION);
+}
+
+RBTreeEx *newDifferenceRBTree(const RBTree *first, const RBTree *second, const RBTreeConfig *config,
+                              const RBSetPolicy *policy)
+{
+    return newSetOperationRBTree(first, second, config, policy, DIFFERENCE);
+}
@@ -0,0 +1,551 @@
+#ifndef RB_TREE_HPP
+#define RB_TREE_HPP
+
+#include "RBTree.h"
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+namespace rb
+{
+
+/**
+ * A typed, header-only version of RBTree for C++ code: an ordered set of T.
+ * The nodes are linked and balanced exactly like RBTree's, but every node holds its T by value instead of a void
+ * pointer to it, and items are compared with a Compare object whose call the compiler sees (and inlines) rather than
+ * through a CompareFunc pointer. Like RBTree, items can't be removed one by one.
+ * items are destroyed and the nodes freed with the tree. Iterators stay valid until then, even as items are added.
+ */
+template<typename T, typename Compare = std::less<T>, typename Alloc = std::allocator<T>>
+class Tree
+{
+private:
+    struct TreeNode
+    {
+        TreeNode *parent, *left, *right;
+        Color color;
+        T value;
+    };
+
+    using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<TreeNode>;
+    using NodeTraits = std::allocator_traits<NodeAlloc>;
+    using ValueTraits = std::allocator_traits<Alloc>;
+
+    TreeNode *m_root = nullptr;
+    std::size_t m_size = 0;
+    Compare m_compare;
+    NodeAlloc m_nodeAlloc;
+
+public:
+    using value_type = T;
+    using key_type = T;
+    using size_type = std::size_t;
+    using key_compare = Compare;
+    using allocator_type = Alloc;
+
+    /**
+     * a bidirectional iterator over the items, in ascending order. Items are the keys of the set, so they can't be
+     * changed through it.
+     */
+    class const_iterator
+    {
+    private:
+        friend class Tree;
+        const TreeNode *m_node;  // nullptr at end()
+        const Tree *m_tree;      // for stepping back from end()
+
+        const_iterator(const TreeNode *node, const Tree *tree) : m_node(node), m_tree(tree)
+        {
+        }
+
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T *;
+        using reference = const T &;
+
+        const_iterator() : m_node(nullptr), m_tree(nullptr)
+        {
+        }
+
+        reference operator*() const
+        {
+            return m_node->value;
+        }
+
+        pointer operator->() const
+        {
+            return &m_node->value;
+        }
+
+        const_iterator &operator++()
+        {
+            m_node = successor(m_node);
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        const_iterator &operator--()
+        {
+            m_node = m_node == nullptr ? maximum(m_tree->m_root) : predecessor(m_node);
+            return *this;
+        }
+
+        const_iterator operator--(int)
+        {
+            const_iterator previous = *this;
+            --*this;
+            return previous;
+        }
+
+        bool operator==(const const_iterator &other) const
+        {
+            return m_node == other.m_node;
+        }
+
+        bool operator!=(const const_iterator &other) const
+        {
+            return m_node != other.m_node;
+        }
+    };
+
+    using iterator = const_iterator;
+
+    explicit Tree(const Compare &compare = Compare(), const Alloc &alloc = Alloc())
+            : m_compare(compare), m_nodeAlloc(alloc)
+    {
+    }
+
+    Tree(const Tree &other)
+            : m_compare(other.m_compare),
+              m_nodeAlloc(NodeTraits::select_on_container_copy_construction(other.m_nodeAlloc))
+    {
+        m_root = copySubtree(other.m_root, nullptr);
+        m_size = other.m_size;
+    }
+
+    Tree(Tree &&other) noexcept
+            : m_root(std::exchange(other.m_root, nullptr)), m_size(std::exchange(other.m_size, 0)),
+              m_compare(std::move(other.m_compare)), m_nodeAlloc(std::move(other.m_nodeAlloc))
+    {
+    }
+
+    Tree &operator=(Tree other) noexcept
+    {
+        // copy (or move) and swap
+        swap(other);
+        return *this;
+    }
+
+    ~Tree()
+    {
+        clear();
+    }
+
+    void swap(Tree &other) noexcept
+    {
+        using std::swap;
+        swap(m_root, other.m_root);
+        swap(m_size, other.m_size);
+        swap(m_compare, other.m_compare);
+        swap(m_nodeAlloc, other.m_nodeAlloc);
+    }
+
+    /**
+     * constructs an item in place and adds it to the tree, unless an equal item is already there.
+     * @return: the item in the tree, and whether it was added.
+     */
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args &&... args)
+    {
+        TreeNode *node = newNode(std::forward<Args>(args)...);
+        auto result = link(node);
+        if (!result.second)
+        {
+            deleteNode(node);
+        }
+        return result;
+    }
+
+    /**
+     * adds an item to the tree, unless an equal item is already there.
+     * @return: the item in the tree, and whether it was added.
+     */
+    std::pair<iterator, bool> insert(const T &value)
+    {
+        return insertUnique(value);
+    }
+
+    std::pair<iterator, bool> insert(T &&value)
+    {
+        return insertUnique(std::move(value));
+    }
+
+    /**
+     * @return: the item equal to 'value', or end() if there's none.
+     */
+    iterator find(const T &value) const
+    {
+        const TreeNode *node = m_root;
+        while (node != nullptr)
+        {
+            if (m_compare(value, node->value))
+            {
+                node = node->left;
+            }
+            else if (m_compare(node->value, value))
+            {
+                node = node->right;
+            }
+            else
+            {
+                return iterator(node, this);
+            }
+        }
+        return end();
+    }
+
+    bool contains(const T &value) const
+    {
+        return find(value) != end();
+    }
+
+    /**
+     * @return: the smallest item >= value, or end() if there's none.
+     */
+    iterator lower_bound(const T &value) const
+    {
+        const TreeNode *node = m_root;
+        const TreeNode *bound = nullptr;
+        while (node != nullptr)
+        {
+            if (m_compare(node->value, value))
+            {
+                node = node->right;
+            }
+            else
+            {
+                bound = node;
+                node = node->left;
+            }
+        }
+        return iterator(bound, this);
+    }
+
+    iterator begin() const
+    {
+        return iterator(minimum(m_root), this);
+    }
+
+    iterator end() const
+    {
+        return iterator(nullptr, this);
+    }
+
+    size_type size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    /**
+     * destroys all the items.
+     */
+    void clear()
+    {
+        // like freeRBTree: free the children before their parent, without recursion
+        TreeNode *node = m_root;
+        while (node != nullptr)
+        {
+            if (node->left != nullptr)
+            {
+                node = node->left;
+            }
+            else if (node->right != nullptr)
+            {
+                node = node->right;
+            }
+            else
+            {
+                TreeNode *parent = node->parent;
+                if (parent != nullptr)
+                {
+                    (parent->left == node ? parent->left : parent->right) = nullptr;
+                }
+                deleteNode(node);
+                node = parent;
+            }
+        }
+        m_root = nullptr;
+        m_size = 0;
+    }
+
+private:
+    template<typename... Args>
+    TreeNode *newNode(Args &&... args)
+    {
+        TreeNode *node = NodeTraits::allocate(m_nodeAlloc, 1);
+        Alloc valueAlloc(m_nodeAlloc);
+        try
+        {
+            ValueTraits::construct(valueAlloc, std::addressof(node->value), std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            NodeTraits::deallocate(m_nodeAlloc, node, 1);
+            throw;
+        }
+        node->parent = node->left = node->right = nullptr;
+        node->color = RED;
+        return node;
+    }
+
+    void deleteNode(TreeNode *node)
+    {
+        Alloc valueAlloc(m_nodeAlloc);
+        ValueTraits::destroy(valueAlloc, std::addressof(node->value));
+        NodeTraits::deallocate(m_nodeAlloc, node, 1);
+    }
+
+    template<typename V>
+    std::pair<iterator, bool> insertUnique(V &&value)
+    {
+        // search first, so nothing is constructed for an item that's already there
+        TreeNode *parent = nullptr;
+        TreeNode **link = &m_root;
+        while (*link != nullptr)
+        {
+            parent = *link;
+            if (m_compare(value, parent->value))
+            {
+                link = &parent->left;
+            }
+            else if (m_compare(parent->value, value))
+            {
+                link = &parent->right;
+            }
+            else
+            {
+                return {iterator(parent, this), false};
+            }
+        }
+        TreeNode *node = newNode(std::forward<V>(value));
+        attach(node, parent, link);
+        return {iterator(node, this), true};
+    }
+
+    std::pair<iterator, bool> link(TreeNode *node)
+    {
+        TreeNode *parent = nullptr;
+        TreeNode **link = &m_root;
+        while (*link != nullptr)
+        {
+            parent = *link;
+            if (m_compare(node->value, parent->value))
+            {
+                link = &parent->left;
+            }
+            else if (m_compare(parent->value, node->value))
+            {
+                link = &parent->right;
+            }
+            else
+            {
+                return {iterator(parent, this), false};
+            }
+        }
+        attach(node, parent, link);
+        return {iterator(node, this), true};
+    }
+
+    void attach(TreeNode *node, TreeNode *parent, TreeNode **link)
+    {
+        node->parent = parent;
+        *link = node;
+        m_size++;
+        fixAfterInsert(node);
+    }
+
+    void replaceChild(TreeNode *node, TreeNode *replacement)
+    {
+        TreeNode *parent = node->parent;
+        if (parent == nullptr)
+        {
+            m_root = replacement;
+        }
+        else if (node == parent->left)
+        {
+            parent->left = replacement;
+        }
+        else
+        {
+            parent->right = replacement;
+        }
+    }
+
+    void rotateLeft(TreeNode *node)
+    {
+        TreeNode *pivot = node->right;
+        node->right = pivot->left;
+        if (pivot->left != nullptr)
+        {
+            pivot->left->parent = node;
+        }
+        pivot->parent = node->parent;
+        replaceChild(node, pivot);
+        pivot->left = node;
+        node->parent = pivot;
+    }
+
+    void rotateRight(TreeNode *node)
+    {
+        TreeNode *pivot = node->left;
+        node->left = pivot->right;
+        if (pivot->right != nullptr)
+        {
+            pivot->right->parent = node;
+        }
+        pivot->parent = node->parent;
+        replaceChild(node, pivot);
+        pivot->right = node;
+        node->parent = pivot;
+    }
+
+    static bool isRed(const TreeNode *node)
+    {
+        return node != nullptr && node->color == RED;
+    }
+
+    void fixAfterInsert(TreeNode *node)
+    {
+        TreeNode *parent;
+        while ((parent = node->parent) != nullptr && isRed(parent))
+        {
+            TreeNode *grandparent = parent->parent;
+            bool parentIsLeft = parent == grandparent->left;
+            TreeNode *uncle = parentIsLeft ? grandparent->right : grandparent->left;
+            if (isRed(uncle))
+            {
+                parent->color = BLACK;
+                uncle->color = BLACK;
+                grandparent->color = RED;
+                node = grandparent;
+                continue;
+            }
+            if (parentIsLeft)
+            {
+                if (node == parent->right)
+                {
+                    rotateLeft(parent);
+                    parent = node;
+                }
+                rotateRight(grandparent);
+            }
+            else
+            {
+                if (node == parent->left)
+                {
+                    rotateRight(parent);
+                    parent = node;
+                }
+                rotateLeft(grandparent);
+            }
+            parent->color = BLACK;
+            grandparent->color = RED;
+            break;
+        }
+        m_root->color = BLACK;
+    }
+
+    TreeNode *copySubtree(const TreeNode *node, TreeNode *parent)
+    {
+        if (node == nullptr)
+        {
+            return nullptr;
+        }
+        TreeNode *copy = newNode(node->value);
+        copy->parent = parent;
+        copy->color = node->color;
+        try
+        {
+            copy->left = copySubtree(node->left, copy);
+            copy->right = copySubtree(node->right, copy);
+        }
+        catch (...)
+        {
+            // free what was copied so far (the failed child was never linked), the same way clear() does
+            copy->parent = nullptr;
+            Tree partial(m_compare, Alloc(m_nodeAlloc));
+            partial.m_root = copy;
+            throw;
+        }
+        return copy;
+    }
+
+    static const TreeNode *minimum(const TreeNode *node)
+    {
+        while (node != nullptr && node->left != nullptr)
+        {
+            node = node->left;
+        }
+        return node;
+    }
+
+    static const TreeNode *maximum(const TreeNode *node)
+    {
+        while (node != nullptr && node->right != nullptr)
+        {
+            node = node->right;
+        }
+        return node;
+    }
+
+    static const TreeNode *successor(const TreeNode *node)
+    {
+        if (node->right != nullptr)
+        {
+            return minimum(node->right);
+        }
+        while (node->parent != nullptr && node == node->parent->right)
+        {
+            node = node->parent;
+        }
+        return node->parent;
+    }
+
+    static const TreeNode *predecessor(const TreeNode *node)
+    {
+        if (node->left != nullptr)
+        {
+            return maximum(node->left);
+        }
+        while (node->parent != nullptr && node == node->parent->left)
+        {
+            node = node->parent;
+        }
+        return node->parent;
+    }
+};
+
+template<typename T, typename Compare, typename Alloc>
+void swap(Tree<T, Compare, Alloc> &first, Tree<T, Compare, Alloc> &second) noexcept
+{
+    first.swap(second);
+}
+
+} // namespace rb
+
+#endif //RB_TREE_HPP
@@ -0,0 +1,242 @@
+#include "rb_veb.h"
+#include "rb_queries.h"
+#include <stdlib.h>
+
+// enough levels for INT_MAX items
+#define MAX_HEIGHT (32)
+
+/*
+ * the array is never searched by recursing into the layout. Instead, a search walks the complete tree by its
+ * breadth first index k (the children of k are 2k and 2k + 1), and finds where the node at depth d is stored from
+ * where its ancestors are. Depth d is the first level of a bottom subtree in exactly one of the recursive splits, and
+ * that split is described by:
+ * - topRoot[d]: the depth of the root of the top subtree, which the whole split subtree is stored from.
+ * - topSize[d]: the size of the top subtree. It has a height of log(topSize[d] + 1), and that many low bits of k tell
+ *   which of the bottom subtrees the node is in.
+ * - bottomSize[d]: the size of each of the bottom subtrees.
+ */
+struct VebRBTree
+{
+    CompareFunc compFunc;
+    int size;
+    int height;
+    void **items; // 2^height - 1 slots, NULL after the greatest item
+    int topRoot[MAX_HEIGHT];
+    size_t topSize[MAX_HEIGHT];
+    size_t bottomSize[MAX_HEIGHT];
+};
+
+/**
+ * fills the tables for the subtree of the given height whose root is at 'rootDepth'.
+ */
+static void splitLayout(VebRBTree *veb, int rootDepth, int height)
+{
+    if (height <= 1)
+    {
+        return;
+    }
+    int top = height / 2;
+    int bottom = height - top;
+    int bottomRoot = rootDepth + top;
+    veb->topRoot[bottomRoot] = rootDepth;
+    veb->topSize[bottomRoot] = ((size_t) 1 << top) - 1;
+    veb->bottomSize[bottomRoot] = ((size_t) 1 << bottom) - 1;
+    splitLayout(veb, rootDepth, top);
+    splitLayout(veb, bottomRoot, bottom);
+}
+
+/**
+ * @param positions: where the ancestors of the node are stored, by depth.
+ * @return: where the node with breadth first index k, at the given depth, is stored.
+ */
+static size_t positionOf(const VebRBTree *veb, const size_t *positions, size_t k, int depth)
+{
+    if (depth == 0)
+    {
+        return 0;
+    }
+    size_t topSize = veb->topSize[depth];
+    return positions[veb->topRoot[depth]] + topSize + (k & topSize) * veb->bottomSize[depth];
+}
+
+/**
+ * walks from the root to a leaf, turning right at every item < probe (or <= probe, if 'orEqual'). Padding is
+ * greater than any probe.
+ * @param positions: filled with where the nodes on the path are stored, by depth.
+ * @return: the path taken: after the leading 1, a bit per level - 1 for a right turn.
+ */
+static size_t descend(const VebRBTree *veb, const void *probe, int orEqual, size_t *positions)
+{
+    size_t k = 1;
+    for (int depth = 0; depth < veb->height; depth++)
+    {
+        positions[depth] = positionOf(veb, positions, k, depth);
+        const void *item = veb->items[positions[depth]];
+        int cmp = item != NULL ? veb->compFunc(probe, item) : -1;
+        k = 2 * k + (orEqual ? cmp >= 0 : cmp > 0);
+    }
+    return k;
+}
+
+/**
+ * @return: the item of the ancestor with breadth first index k (0 for none) on the path 'positions' was filled by.
+ */
+static void *itemOnPath(const VebRBTree *veb, const size_t *positions, size_t k)
+{
+    if (k == 0)
+    {
+        return NULL;
+    }
+    int depth = 63 - __builtin_clzll((unsigned long long) k);
+    return veb->items[positions[depth]];
+}
+
+typedef int (*SlotVisitor)(void **slot, void *args);
+
+/**
+ * visits the slots of the subtree at breadth first index k in ascending order, until 'visit' returns 0.
+ * @return: 0 if 'visit' returned 0, other otherwise.
+ */
+static int inOrder(const VebRBTree *veb, size_t k, int depth, size_t *positions, SlotVisitor visit, void *args)
+{
+    if (depth == veb->height)
+    {
+        return 1;
+    }
+    positions[depth] = positionOf(veb, positions, k, depth);
+    return inOrder(veb, 2 * k, depth + 1, positions, visit, args) &&
+           visit(&veb->items[positions[depth]], args) &&
+           inOrder(veb, 2 * k + 1, depth + 1, positions, visit, args);
+}
+
+typedef struct FillState
+{
+    RBIterator iterator;
+    void *next;
+} FillState;
+
+static int fillSlot(void **slot, void *args)
+{
+    FillState *state = (FillState *) args;
+    *slot = state->next;
+    if (state->next != NULL)
+    {
+        state->next = nextRBTree(&state->iterator);
+    }
+    return 1;
+}
+
+VebRBTree *exportVebRBTree(const RBTree *tree)
+{
+    if (tree == NULL || tree->compFunc == NULL || tree->size < 0)
+    {
+        return NULL;
+    }
+    VebRBTree *veb = (VebRBTree *) malloc(sizeof(VebRBTree));
+    if (veb == NULL)
+    {
+        return NULL;
+    }
+    veb->compFunc = tree->compFunc;
+    veb->size = tree->size;
+    veb->height = 0;
+    while ((((size_t) 1 << veb->height) - 1) < (size_t) tree->size)
+    {
+        veb->height++;
+    }
+    veb->items = NULL;
+    if (veb->height > 0)
+    {
+        veb->items = (void **) malloc((((size_t) 1 << veb->height) - 1) * sizeof(void *));
+        if (veb->items == NULL)
+        {
+            free(veb);
+            return NULL;
+        }
+    }
+    splitLayout(veb, 0, veb->height);
+    // the tree and the slots are both walked in ascending order, so each item lands in its place
+    FillState state;
+    state.next = firstRBTree(tree, &state.iterator);
+    size_t positions[MAX_HEIGHT];
+    inOrder(veb, 1, 0, positions, fillSlot, &state);
+    return veb;
+}
+
+int containsVebRBTree(const VebRBTree *veb, const void *data)
+{
+    const void *ceiling = ceilingVebRBTree(veb, data);
+    return ceiling != NULL && veb->compFunc(data, ceiling) == 0;
+}
+
+void *floorVebRBTree(const VebRBTree *veb, const void *probe)
+{
+    if (veb == NULL || probe == NULL)
+    {
+        return NULL;
+    }
+    // the floor is where the path last turned right: drop the trailing left turns, and that right turn
+    size_t positions[MAX_HEIGHT];
+    size_t path = descend(veb, probe, 1, positions);
+    return itemOnPath(veb, positions, path >> __builtin_ffsll((long long) path));
+}
+
+void *ceilingVebRBTree(const VebRBTree *veb, const void *probe)
+{
+    if (veb == NULL || probe == NULL)
+    {
+        return NULL;
+    }
+    // the ceiling is where the path last turned left (which is NULL if that's padding)
+    size_t positions[MAX_HEIGHT];
+    size_t path = descend(veb, probe, 0, positions);
+    return itemOnPath(veb, positions, path >> __builtin_ffsll((long long) ~path));
+}
+
+typedef struct VisitState
+{
+    forEachFunc func;
+    void *args;
+    int remaining;
+    int failed;
+} VisitState;
+
+static int visitSlot(void **slot, void *args)
+{
+    VisitState *state = (VisitState *) args;
+    // the padding is all after the last item
+    if (state->remaining == 0)
+    {
+        return 0;
+    }
+    state->remaining--;
+    state->failed = !state->func(*slot, state->args);
+    return !state->failed;
+}
+
+int forEachVebRBTree(const VebRBTree *veb, forEachFunc func, void *args)
+{
+    if (veb == NULL || func == NULL)
+    {
+        return 0;
+    }
+    VisitState state = {func, args, veb->size, 0};
+    size_t positions[MAX_HEIGHT];
+    inOrder(veb, 1, 0, positions, visitSlot, &state);
+    return !state.failed;
+}
+
+int sizeOfVebRBTree(const VebRBTree *veb)
+{
+    return veb != NULL ? veb->size : 0;
+}
+
+void freeVebRBTree(VebRBTree *veb)
+{
+    if (veb == NULL)
+    {
+        return;
+    }
+    free(veb->items);
+    free(veb);
+}
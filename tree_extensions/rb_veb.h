@@ -0,0 +1,72 @@
+#ifndef RB_VEB_H
+#define RB_VEB_H
+
+#include "RBTree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * An immutable, read-only copy of a RBTree in van Emde Boas order: a complete search tree of height h is stored as
+ * its top half (of height h/2) followed by each of the subtrees hanging below it, and each of those is laid out the
+ * same way, recursively. Whatever the size B of a cache line or a page, a search crosses O(log_B n) of them - so
+ * unlike FrozenRBTree (rb_frozen.h) it's efficient at every level of the memory hierarchy without being tuned for
+ * any.
+ * the search tree is perfectly balanced, so the array is padded up to the next power of 2 (at most twice the items).
+ * it holds the tree's items, not copies of them: they must stay alive (and unchanged) while it's used, and it never
+ * frees them.
+ */
+typedef struct VebRBTree VebRBTree;
+
+/**
+ * copies a tree into a new van Emde Boas ordered tree, in O(n). Works with any RBTree, and doesn't change it.
+ * @param tree: the tree to copy. Its CompareFunc is used for searching the copy.
+ * @return: the copy, or NULL on failure.
+ */
+VebRBTree *exportVebRBTree(const RBTree *tree);
+
+/**
+ * check whether the copy contains this item.
+ * @param veb: the copy to check an item in.
+ * @param data: item to check.
+ * @return: 0 if the item is not in the copy, other if it is.
+ */
+int containsVebRBTree(const VebRBTree *veb, const void *data);
+
+/**
+ * @return: the greatest item <= probe, or NULL if there's none.
+ */
+void *floorVebRBTree(const VebRBTree *veb, const void *probe);
+
+/**
+ * @return: the smallest item >= probe, or NULL if there's none.
+ */
+void *ceilingVebRBTree(const VebRBTree *veb, const void *probe);
+
+/**
+ * Activate a function on each item of the copy, in ascending order. if one of the activations of the function
+ * returns 0, the process stops.
+ * @param veb: the copy with all the items.
+ * @param func: the function to activate on all items.
+ * @param args: more optional arguments to the function (may be null if the given function support it).
+ * @return: 0 on failure, other on success.
+ */
+int forEachVebRBTree(const VebRBTree *veb, forEachFunc func, void *args);
+
+/**
+ * @return: number of items in the copy.
+ */
+int sizeOfVebRBTree(const VebRBTree *veb);
+
+/**
+ * free all memory of the copy. (not the items, which belong to the original tree)
+ * @param veb: the copy to free.
+ */
+void freeVebRBTree(VebRBTree *veb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RB_VEB_H
@@ -0,0 +1,217 @@
+// posix_memalign
+#define _POSIX_C_SOURCE 200112L
+
+#include "skip_list.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// with every level holding half the nodes of the one below it, enough for 2^32 items
+#define MAX_LEVEL (32)
+#define CACHE_LINE (64)
+
+typedef struct SkipNode
+{
+    void *data;
+    int height;
+    struct SkipNode *next[]; // 'height' links, accessed atomically
+} SkipNode;
+
+struct SkipList
+{
+    // read by every traversal
+    CompareFunc compFunc;
+    FreeFunc freeFunc;
+    SkipNode *head; // has MAX_LEVEL links and no item
+    char readPadding[CACHE_LINE - sizeof(CompareFunc) - sizeof(FreeFunc) - sizeof(SkipNode *)];
+    // written by every insertion, so they're kept off the line above - or each insertion would invalidate it in
+    // every other thread's cache
+    uint64_t seed; // accessed atomically, for choosing node heights
+    int size;      // accessed atomically
+    char writePadding[CACHE_LINE - sizeof(uint64_t) - sizeof(int)];
+};
+
+static SkipNode *loadNext(SkipNode *node, int level)
+{
+    return __atomic_load_n(&node->next[level], __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @return: a random height in [1, MAX_LEVEL], where each height is half as likely as the one below it.
+ */
+static int randomHeight(SkipList *list)
+{
+    // splitmix64 of a shared counter - no lock, and no state per thread
+    uint64_t bits = __atomic_add_fetch(&list->seed, 0x9E3779B97F4A7C15ULL, __ATOMIC_RELAXED);
+    bits = (bits ^ (bits >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    bits = (bits ^ (bits >> 27)) * 0x94D049BB133111EBULL;
+    bits ^= bits >> 31;
+    return 1 + __builtin_ctzll(bits | (1ULL << (MAX_LEVEL - 1)));
+}
+
+/**
+ * finds, at every level, the last node whose item is smaller than 'data' and the one right after it.
+ * @return: the node holding an item equal to 'data', or NULL.
+ */
+static SkipNode *find(SkipList *list, const void *data, SkipNode **preds, SkipNode **succs)
+{
+    SkipNode *pred = list->head;
+    SkipNode *curr = NULL;
+    for (int level = MAX_LEVEL - 1; level >= 0; level--)
+    {
+        curr = loadNext(pred, level);
+        while (curr != NULL && list->compFunc(data, curr->data) > 0)
+        {
+            pred = curr;
+            curr = loadNext(pred, level);
+        }
+        if (preds != NULL)
+        {
+            preds[level] = pred;
+            succs[level] = curr;
+        }
+    }
+    return curr != NULL && list->compFunc(data, curr->data) == 0 ? curr : NULL;
+}
+
+SkipList *newSkipList(CompareFunc compFunc, FreeFunc freeFunc)
+{
+    if (compFunc == NULL)
+    {
+        return NULL;
+    }
+    void *memory;
+    if (posix_memalign(&memory, CACHE_LINE, sizeof(SkipList)) != 0)
+    {
+        return NULL;
+    }
+    SkipList *list = (SkipList *) memory;
+    list->head = (SkipNode *) malloc(sizeof(SkipNode) + MAX_LEVEL * sizeof(SkipNode *));
+    if (list->head == NULL)
+    {
+        free(list);
+        return NULL;
+    }
+    list->head->data = NULL;
+    list->head->height = MAX_LEVEL;
+    for (int level = 0; level < MAX_LEVEL; level++)
+    {
+        list->head->next[level] = NULL;
+    }
+    list->compFunc = compFunc;
+    list->freeFunc = freeFunc;
+    list->size = 0;
+    list->seed = (uint64_t) (uintptr_t) list;
+    return list;
+}
+
+int addToSkipList(SkipList *list, void *data)
+{
+    if (list == NULL || data == NULL)
+    {
+        return 0;
+    }
+    SkipNode *preds[MAX_LEVEL], *succs[MAX_LEVEL];
+    if (find(list, data, preds, succs) != NULL)
+    {
+        return 0;
+    }
+    // reserve a place in the size first, so it never exceeds INT_MAX
+    if (__atomic_add_fetch(&list->size, 1, __ATOMIC_RELAXED) < 0)
+    {
+        __atomic_sub_fetch(&list->size, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    int height = randomHeight(list);
+    SkipNode *node = (SkipNode *) malloc(sizeof(SkipNode) + height * sizeof(SkipNode *));
+    if (node == NULL)
+    {
+        __atomic_sub_fetch(&list->size, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    node->data = data;
+    node->height = height;
+    // the node is in the list once it's linked into the bottom level. Losing that race to another thread means
+    // searching again - maybe the other thread added an equal item
+    while (1)
+    {
+        for (int level = 0; level < height; level++)
+        {
+            __atomic_store_n(&node->next[level], succs[level], __ATOMIC_RELAXED);
+        }
+        SkipNode *expected = succs[0];
+        if (__atomic_compare_exchange_n(&preds[0]->next[0], &expected, node, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        {
+            break;
+        }
+        if (find(list, data, preds, succs) != NULL)
+        {
+            __atomic_sub_fetch(&list->size, 1, __ATOMIC_RELAXED);
+            free(node);
+            return 0;
+        }
+    }
+    // the upper levels only speed up searches, so they're linked one at a time, after the node is already in
+    for (int level = 1; level < height; level++)
+    {
+        while (1)
+        {
+            SkipNode *expected = succs[level];
+            if (__atomic_compare_exchange_n(&preds[level]->next[level], &expected, node, 0, __ATOMIC_RELEASE,
+                                            __ATOMIC_RELAXED))
+            {
+                break;
+            }
+            find(list, data, preds, succs);
+            __atomic_store_n(&node->next[level], succs[level], __ATOMIC_RELAXED);
+        }
+    }
+    return 1;
+}
+
+int containsSkipList(SkipList *list, const void *data)
+{
+    return list != NULL && data != NULL && find(list, data, NULL, NULL) != NULL;
+}
+
+int forEachSkipList(SkipList *list, forEachFunc func, void *args)
+{
+    if (list == NULL || func == NULL)
+    {
+        return 0;
+    }
+    for (SkipNode *node = loadNext(list->head, 0); node != NULL; node = loadNext(node, 0))
+    {
+        if (!func(node->data, args))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int sizeOfSkipList(SkipList *list)
+{
+    return list != NULL ? __atomic_load_n(&list->size, __ATOMIC_RELAXED) : 0;
+}
+
+void freeSkipList(SkipList *list)
+{
+    if (list == NULL)
+    {
+        return;
+    }
+    SkipNode *node = list->head->next[0];
+    while (node != NULL)
+    {
+        SkipNode *next = node->next[0];
+        if (list->freeFunc != NULL)
+        {
+            list->freeFunc(node->data);
+        }
+        free(node);
+        node = next;
+    }
+    free(list->head);
+    free(list);
+}
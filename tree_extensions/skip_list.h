@@ -0,0 +1,69 @@
+#ifndef SKIP_LIST_H
+#define SKIP_LIST_H
+
+#include "RBTree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * An ordered set with the same surface as RBTree.h, for many threads adding items at once.
+ * it's a lock-free skip list: an item is added by linking its node into each level with a compare-and-swap, so no
+ * thread ever waits for another, and there's no rebalancing to contend on. Items are never removed, so a node is
+ * never freed while the list is in use.
+ * every function may be called from any number of threads at once, except freeSkipList.
+ */
+typedef struct SkipList SkipList;
+
+/**
+ * constructs a new, empty skip list.
+ * @param compFunc: a function two compare two variables. Called from several threads at once.
+ * @param freeFunc: a function to free a data item, may be NULL.
+ * @return: the new list, or NULL on failure.
+ */
+SkipList *newSkipList(CompareFunc compFunc, FreeFunc freeFunc);
+
+/**
+ * add an item to the list, in expected O(log n).
+ * @param list: the list to add an item to.
+ * @param data: item to add to the list.
+ * @return: 0 on failure, other on success. (if the item is already in the list - failure).
+ */
+int addToSkipList(SkipList *list, void *data);
+
+/**
+ * check whether the list contains this item, in expected O(log n).
+ * @param list: the list to check an item in.
+ * @param data: item to check.
+ * @return: 0 if the item is not in the list, other if it is.
+ */
+int containsSkipList(SkipList *list, const void *data);
+
+/**
+ * Activate a function on each item of the list, in ascending order. if one of the activations of the function
+ * returns 0, the process stops. Items added meanwhile may or may not be visited.
+ * @param list: the list with all the items.
+ * @param func: the function to activate on all items.
+ * @param args: more optional arguments to the function (may be null if the given function support it).
+ * @return: 0 on failure, other on success.
+ */
+int forEachSkipList(SkipList *list, forEachFunc func, void *args);
+
+/**
+ * @return: number of items in the list.
+ */
+int sizeOfSkipList(SkipList *list);
+
+/**
+ * free all memory of the data structure, calling its FreeFunc (if any) on every item. No other thread may be using
+ * the list.
+ * @param list: the list to free.
+ */
+void freeSkipList(SkipList *list);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SKIP_LIST_H
@@ -0,0 +1,257 @@
+// sysconf
+#define _POSIX_C_SOURCE 200112L
+
+#include "task_pool.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// forks are joined in reverse order, so a deque only grows as deep as the nesting of forks. A fork that doesn't fit
+// is run right away instead
+#define DEQUE_CAPACITY (256)
+
+struct TaskWorker
+{
+    TaskPool *pool;
+    unsigned int index;
+    unsigned int victim;           // the worker to try stealing from next
+    pthread_t thread;
+    pthread_mutex_t lock;          // guards the deque
+    size_t top, bottom;            // the deque is deque[top, bottom). The owner works at the bottom, thieves at the top
+    Task *deque[DEQUE_CAPACITY];
+};
+
+struct TaskPool
+{
+    unsigned int threads;
+    TaskWorker *workers;
+    pthread_mutex_t lock; // guards 'pending' and 'stopping'
+    pthread_cond_t wake;  // signaled when a task is forked, or the pool is stopping
+    size_t pending;       // tasks in all the deques
+    int stopping;
+};
+
+static void runTask(TaskWorker *worker, Task *task)
+{
+    task->func(task, worker);
+    __atomic_store_n(&task->done, 1, __ATOMIC_RELEASE);
+}
+
+static void taskTaken(TaskPool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->pending--;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @return: the oldest task of another worker's deque, or NULL if there's none.
+ */
+static Task *steal(TaskWorker *thief)
+{
+    TaskPool *pool = thief->pool;
+    for (unsigned int attempt = 1; attempt < pool->threads; attempt++)
+    {
+        TaskWorker *victim = &pool->workers[thief->victim];
+        thief->victim = (thief->victim + 1) % pool->threads;
+        if (victim == thief)
+        {
+            victim = &pool->workers[thief->victim];
+            thief->victim = (thief->victim + 1) % pool->threads;
+        }
+        Task *task = NULL;
+        pthread_mutex_lock(&victim->lock);
+        if (victim->top < victim->bottom)
+        {
+            task = victim->deque[victim->top++];
+        }
+        pthread_mutex_unlock(&victim->lock);
+        if (task != NULL)
+        {
+            taskTaken(pool);
+            return task;
+        }
+    }
+    return NULL;
+}
+
+static void *workerMain(void *args)
+{
+    TaskWorker *worker = (TaskWorker *) args;
+    TaskPool *pool = worker->pool;
+    while (1)
+    {
+        Task *task = steal(worker);
+        if (task != NULL)
+        {
+            runTask(worker, task);
+            continue;
+        }
+        pthread_mutex_lock(&pool->lock);
+        while (pool->pending == 0 && !pool->stopping)
+        {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        int stopping = pool->stopping;
+        pthread_mutex_unlock(&pool->lock);
+        if (stopping)
+        {
+            return NULL;
+        }
+    }
+}
+
+/**
+ * stops and joins the threads of workers [1, count), and frees the pool.
+ */
+static void stopPool(TaskPool *pool, unsigned int count)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (unsigned int i = 1; i < count; i++)
+    {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    for (unsigned int i = 0; i < pool->threads; i++)
+    {
+        pthread_mutex_destroy(&pool->workers[i].lock);
+    }
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool);
+}
+
+TaskPool *newTaskPool(unsigned int threads)
+{
+    if (threads == 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (unsigned int) cpus : 1;
+    }
+    TaskPool *pool = (TaskPool *) malloc(sizeof(TaskPool));
+    if (pool == NULL)
+    {
+        return NULL;
+    }
+    pool->workers = (TaskWorker *) malloc(threads * sizeof(TaskWorker));
+    if (pool->workers == NULL)
+    {
+        free(pool);
+        return NULL;
+    }
+    pool->threads = threads;
+    pool->pending = 0;
+    pool->stopping = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        TaskWorker *worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->index = i;
+        worker->victim = (i + 1) % threads;
+        worker->top = 0;
+        worker->bottom = 0;
+        pthread_mutex_init(&worker->lock, NULL);
+    }
+    // worker 0 is whichever thread calls taskPoolRun
+    for (unsigned int i = 1; i < threads; i++)
+    {
+        if (pthread_create(&pool->workers[i].thread, NULL, workerMain, &pool->workers[i]) != 0)
+        {
+            stopPool(pool, i);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+unsigned int taskPoolThreads(const TaskPool *pool)
+{
+    return pool->threads;
+}
+
+void taskPoolRun(TaskPool *pool, Task *task)
+{
+    runTask(&pool->workers[0], task);
+}
+
+unsigned int taskWorkerIndex(const TaskWorker *worker)
+{
+    return worker->index;
+}
+
+void taskFork(TaskWorker *worker, Task *task)
+{
+    __atomic_store_n(&task->done, 0, __ATOMIC_RELAXED);
+    int pushed = 0;
+    pthread_mutex_lock(&worker->lock);
+    if (worker->top == worker->bottom)
+    {
+        worker->top = 0;
+        worker->bottom = 0;
+    }
+    if (worker->bottom < DEQUE_CAPACITY)
+    {
+        worker->deque[worker->bottom++] = task;
+        pushed = 1;
+    }
+    pthread_mutex_unlock(&worker->lock);
+    if (!pushed)
+    {
+        runTask(worker, task);
+        return;
+    }
+    TaskPool *pool = worker->pool;
+    pthread_mutex_lock(&pool->lock);
+    pool->pending++;
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void taskJoin(TaskWorker *worker, Task *task)
+{
+    if (__atomic_load_n(&task->done, __ATOMIC_ACQUIRE))
+    {
+        return;
+    }
+    // unless it was stolen, the task is the most recent fork, at the bottom of the deque
+    int popped = 0;
+    pthread_mutex_lock(&worker->lock);
+    if (worker->top < worker->bottom && worker->deque[worker->bottom - 1] == task)
+    {
+        worker->bottom--;
+        popped = 1;
+    }
+    pthread_mutex_unlock(&worker->lock);
+    if (popped)
+    {
+        taskTaken(worker->pool);
+        runTask(worker, task);
+        return;
+    }
+    while (!__atomic_load_n(&task->done, __ATOMIC_ACQUIRE))
+    {
+        Task *other = steal(worker);
+        if (other != NULL)
+        {
+            runTask(worker, other);
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+}
+
+void freeTaskPool(TaskPool *pool)
+{
+    if (pool != NULL)
+    {
+        stopPool(pool, pool->threads);
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A fork-join thread pool. Every thread has its own deque of forked tasks; a thread that runs out of work steals the
+ * oldest task of another thread's deque, and a thread that waits for a stolen task runs other tasks meanwhile.
+ */
+typedef struct TaskPool TaskPool;
+
+/**
+ * one of the threads of a pool, as seen by the task it runs.
+ */
+typedef struct TaskWorker TaskWorker;
+
+typedef struct Task Task;
+
+/**
+ * the body of a task.
+ * @param task: the task being run.
+ * @param worker: the thread running it, for forking and joining sub tasks.
+ */
+typedef void (*TaskFunc)(Task *task, TaskWorker *worker);
+
+/**
+ * a unit of work. Embed it as the first member of a struct holding the task's arguments and results.
+ */
+struct Task
+{
+    TaskFunc func;
+    int done; // set once 'func' returned, accessed atomically
+};
+
+/**
+ * creates a pool and starts its threads.
+ * @param threads: number of threads to run tasks on, including the one calling taskPoolRun. 0 for one per CPU.
+ * @return: the new pool, or NULL on failure.
+ */
+TaskPool *newTaskPool(unsigned int threads);
+
+/**
+ * @return: number of threads tasks of the pool run on.
+ */
+unsigned int taskPoolThreads(const TaskPool *pool);
+
+/**
+ * runs 'task' (and every task it forks) on the pool, with the calling thread as one of the pool's threads.
+ * returns once it's done. Only one thread at a time may call this for a given pool.
+ */
+void taskPoolRun(TaskPool *pool, Task *task);
+
+/**
+ * @return: index of the worker, in [0, taskPoolThreads(pool)). Worker 0 is the thread that called taskPoolRun.
+ */
+unsigned int taskWorkerIndex(const TaskWorker *worker);
+
+/**
+ * makes 'task' available to run in parallel with the caller. Every forked task must be joined by the worker that
+ * forked it, in reverse order of forking.
+ */
+void taskFork(TaskWorker *worker, Task *task);
+
+/**
+ * waits until a task forked by 'worker' is done - running it on the calling thread if no other thread took it yet.
+ */
+void taskJoin(TaskWorker *worker, Task *task);
+
+/**
+ * stops the threads of the pool, and frees it.
+ */
+void freeTaskPool(TaskPool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //TASK_POOL_H
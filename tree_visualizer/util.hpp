@@ -24,8 +24,14 @@
 
 using DataFormatter = std::function<std::string(const void*)>;
 
+// treeToDot reads the parent and color of nodes through these, so it can draw other node layouts too: a header
+// declaring another node type provides the same overloads for it (see tree_extensions/rb_compact.h)
+static inline const Node *nodeParent(const Node *node) { return node->parent; }
+static inline Color nodeColor(const Node *node) { return node->color; }
+
 /**
  * Emits the 'dot' representation of a RB node starting from given node
+ * @tparam NodeType Node, or another node type with nodeParent and nodeColor overloads
  * @param node Root of tree to be drawn
  * @param label Label of node
  * @param callCounter Used to differentiate between same nodes/edges that appear in multiple subgraphs
@@ -33,26 +39,27 @@ using DataFormatter = std::function<std::string(const void*)>;
  * @param dataFormatter Function that converts a void pointer to a string
  * @param includeAddresses Whether we should emit addresses
  */
-static void treeToDot(const Node &rootNode, const std::string &label, int &callCounter, std::ostream &dotStream,
-                      std::map<const Node*, std::pair<std::string, int>> &tags,
+template <typename NodeType>
+static void treeToDot(const NodeType &rootNode, const std::string &label, int &callCounter, std::ostream &dotStream,
+                      std::map<const void*, std::pair<std::string, int>> &tags,
                       DataFormatter dataFormatter, bool includeAddresses=false, bool drawParents=false)
 {
-    std::set<const Node*> visited;
+    std::set<const NodeType*> visited;
     callCounter++;
     std::stringstream nodeDefinitions;
     std::stringstream edgeDefinitions;
     std::string subgraph_label = "cluster_" + label + "_count_" + std::to_string(callCounter);
     dotStream << "subgraph \"" << subgraph_label << "\"{" << std::endl;
     dotStream << "label =\"" << label << "\";" << std::endl;
-    auto nodeToLabel = [&](const Node* node, const std::string &extra = "") {
+    auto nodeToLabel = [&](const NodeType* node, const std::string &extra = "") {
         std::stringstream ss;
         ss << "\"" << subgraph_label << "_data_" << dataFormatter(node->data) << extra << "\"";
         return ss.str();
     };
-    auto nodeToDef = [&](const Node* node) {
+    auto nodeToDef = [&](const NodeType* node) {
         std::stringstream ss;
         auto color = "black";
-        if (node->color == RED) {
+        if (nodeColor(node) == RED) {
             color = "red";
         }
         std::stringstream label;
@@ -69,7 +76,7 @@ static void treeToDot(const Node &rootNode, const std::string &label, int &callC
         ss << "[shape=record color=" << color << " label=\"" << label.str() << "\"];";
         return ss.str();
     };
-    std::function<void(const Node*)> nodeToDot = [&](const Node* node) {
+    std::function<void(const NodeType*)> nodeToDot = [&](const NodeType* node) {
         if (node == nullptr) {
             return;
         }
@@ -82,8 +89,8 @@ static void treeToDot(const Node &rootNode, const std::string &label, int &callC
         }
         visited.insert(node);
         // can only draw parent if it was added to this graph(in a previous recursive call)
-        if (drawParents && node->parent != nullptr && visited.find(node->parent) != visited.cend()) {
-            edgeDefinitions << nodeToLabel(node) << " -> " << nodeToLabel(node->parent) << "[style=dotted];" << std::endl;
+        if (drawParents && nodeParent(node) != nullptr && visited.find(nodeParent(node)) != visited.cend()) {
+            edgeDefinitions << nodeToLabel(node) << " -> " << nodeToLabel(nodeParent(node)) << "[style=dotted];" << std::endl;
         }
         if(node->left != nullptr) {
             edgeDefinitions << nodeToLabel(node) << " -> " << nodeToLabel(node->left) << "[label=L];" << std::endl;
@@ -154,7 +161,7 @@ private:
     std::stringstream m_stringstream;
     int m_callCounter = 0;
     std::vector<std::string> m_ops;
-    std::map<const Node*, std::pair<std::string, int>> m_nodeTags;
+    std::map<const void*, std::pair<std::string, int>> m_nodeTags;
 
 public:
 
@@ -208,7 +215,8 @@ public:
         return ret_val;
     }
 
-    void addStep(const Node &node, const std::string &stepName) {
+    template <typename NodeType, decltype(std::declval<const NodeType &>().data) * = nullptr>
+    void addStep(const NodeType &node, const std::string &stepName) {
         if (!enabled) {
             return;
         }
@@ -233,8 +241,18 @@ public:
         }
         addStep(*tree.root, stepName);
     }
+    // trees of other node types, such as CompactRBTree
+    template <typename TreeType, decltype(std::declval<const TreeType &>().root) * = nullptr>
+    void addStep(const TreeType &tree, const std::string &stepName)
+    {
+        if (tree.root == nullptr) {
+            fprintf(stderr, "While calling addStep, tree must have a root\n");
+            exit(-1);
+        }
+        addStep(*tree.root, stepName);
+    }
 
-    void tagNode(const Node *node, const std::string& tag, int steps) {
+    void tagNode(const void *node, const std::string& tag, int steps) {
         if (!enabled) {
             return;
         }
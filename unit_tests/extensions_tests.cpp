@@ -0,0 +1,1989 @@
+#include "RBTree.h"
+#include "catch.hpp"
+#include "tree_extensions/b_tree.h"
+#include "tree_extensions/rb_compact.h"
+#include "tree_extensions/rb_concurrent.h"
+#include "tree_extensions/rb_define.h"
+#include "tree_extensions/rb_extensions.h"
+#include "tree_extensions/rb_frozen.h"
+#include "tree_extensions/rb_indexed.h"
+#include "tree_extensions/rb_parallel.h"
+#include "tree_extensions/rb_persistent.h"
+#include "tree_extensions/rb_queries.h"
+#include "tree_extensions/rb_tree.hpp"
+#include "tree_extensions/rb_veb.h"
+#include "tree_extensions/skip_list.h"
+#include "tree_visualizer/util.hpp"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int compareInts(const void *aa, const void *bb)
+{
+    int a = *(const int *) aa;
+    int b = *(const int *) bb;
+    return (a > b) - (a < b);
+}
+
+static int comparisons = 0;
+
+static int countingCompareInts(const void *a, const void *b)
+{
+    ++comparisons;
+    return compareInts(a, b);
+}
+
+static void noFree(void *data)
+{
+    // RBTree.c may call the FreeFunc without checking it
+    (void) data;
+}
+
+static const int *storedBegin, *storedEnd;
+static int misorderedComparisons = 0;
+
+/**
+ * compares like compareInts, counting the calls whose second argument isn't a stored item
+ */
+static int compareProbeToStored(const void *probe, const void *stored) {
+    if ((const int *) stored < storedBegin || (const int *) stored >= storedEnd) {
+        misorderedComparisons++;
+    }
+    return compareInts(probe, stored);
+}
+
+static int collectInts(const void *object, void *args)
+{
+    auto *out = (std::vector<int> *) args;
+    out->push_back(*(const int *) object);
+    return 1;
+}
+
+/**
+ * Checks parent links, ordering and the RB properties of the subtree at 'node'
+ * @return Black height of the subtree, or -1 if it is invalid
+ */
+static int checkSubtree(const RBTree &tree, const Node *node, const Node *parent)
+{
+    if (node == nullptr) {
+        return 1;
+    }
+    if (node->parent != parent) {
+        return -1;
+    }
+    if (node->color == RED && parent != nullptr && parent->color == RED) {
+        return -1;
+    }
+    if (node->left != nullptr && tree.compFunc(node->left->data, node->data) >= 0) {
+        return -1;
+    }
+    if (node->right != nullptr && tree.compFunc(node->right->data, node->data) <= 0) {
+        return -1;
+    }
+    int left = checkSubtree(tree, node->left, node);
+    int right = checkSubtree(tree, node->right, node);
+    if (left < 0 || left != right) {
+        return -1;
+    }
+    return left + (node->color == BLACK ? 1 : 0);
+}
+
+static bool isValidRBTree(const RBTree &tree)
+{
+    if (tree.root != nullptr && tree.root->color != BLACK) {
+        return false;
+    }
+    return checkSubtree(tree, tree.root, nullptr) > 0;
+}
+
+static std::vector<int> treeToVector(RBTree &tree)
+{
+    std::vector<int> out;
+    forEachRBTree(&tree, collectInts, &out);
+    return out;
+}
+
+SCENARIO("Arena backed trees behave like regular trees", "[extensions][arena]") {
+    GIVEN("10000 shuffled integers") {
+        std::vector<int> elements(10000);
+        std::iota(elements.begin(), elements.end(), 0);
+        std::shuffle(elements.begin(), elements.end(), std::default_random_engine {});
+
+        auto useArena = GENERATE(0, 1);
+        RBTreeConfig config = { useArena, NODE_ARENA_KEEP_ALL };
+        RBTreeEx *tree = newRBTreeEx(compareInts, nullptr, &config);
+        REQUIRE(tree != nullptr);
+        REQUIRE((tree->arena != nullptr) == (useArena != 0));
+
+        for (auto &element: elements) {
+            REQUIRE(addToRBTreeEx(tree, &element));
+        }
+
+        THEN("the tree is a valid RB tree holding all of them in order") {
+            REQUIRE(tree->base.size == (int) elements.size());
+            REQUIRE(isValidRBTree(tree->base));
+            std::vector<int> sorted(elements);
+            std::sort(sorted.begin(), sorted.end());
+            REQUIRE(treeToVector(tree->base) == sorted);
+        }
+
+        THEN("duplicates are rejected") {
+            int duplicate = 42;
+            REQUIRE(!addToRBTreeEx(tree, &duplicate));
+            REQUIRE(tree->base.size == (int) elements.size());
+            REQUIRE(containsRBTree(&tree->base, &duplicate));
+        }
+
+        freeRBTreeEx(tree);
+    }
+}
+
+TEST_CASE("Node arena returns idle chunks to the OS", "[extensions][arena]") {
+    NodeArena *arena = newNodeArena(sizeof(Node), 1);
+    REQUIRE(arena != nullptr);
+    std::vector<void *> nodes;
+    for (int i = 0; i < 100000; i++) {
+        void *node = nodeArenaAlloc(arena);
+        REQUIRE(node != nullptr);
+        REQUIRE((uintptr_t) node % alignof(Node) == 0);
+        nodes.push_back(node);
+    }
+    size_t reserved = nodeArenaReservedBytes(arena);
+    REQUIRE(reserved >= nodes.size() * sizeof(Node));
+
+    for (auto node: nodes) {
+        nodeArenaRelease(arena, node);
+    }
+    // at most one idle chunk is kept
+    REQUIRE(nodeArenaReservedBytes(arena) < reserved);
+    REQUIRE(nodeArenaReservedBytes(arena) <= 64 * 1024);
+
+    nodeArenaTrim(arena);
+    REQUIRE(nodeArenaReservedBytes(arena) == 0);
+    REQUIRE(nodeArenaAlloc(arena) != nullptr);
+    freeNodeArena(arena);
+}
+
+static int freedCount = 0;
+
+static void countFree(void *data)
+{
+    (void) data;
+    ++freedCount;
+}
+
+SCENARIO("Removing items keeps the tree balanced", "[extensions][remove]") {
+    GIVEN("A tree of 2000 shuffled integers") {
+        std::vector<int> elements(2000);
+        std::iota(elements.begin(), elements.end(), 0);
+        auto rng = std::default_random_engine {};
+        std::shuffle(elements.begin(), elements.end(), rng);
+
+        auto useArena = GENERATE(0, 1);
+        RBTreeConfig config = { useArena, 0 };
+        RBTreeEx *tree = newRBTreeEx(compareInts, countFree, &config);
+        for (auto &element: elements) {
+            REQUIRE(addToRBTreeEx(tree, &element));
+        }
+        freedCount = 0;
+
+        WHEN("removing every other item in random order") {
+            std::vector<int> removed, kept;
+            for (auto element: elements) {
+                (element % 2 == 0 ? removed : kept).push_back(element);
+            }
+            std::shuffle(removed.begin(), removed.end(), rng);
+            for (size_t i = 0; i < removed.size(); i++) {
+                REQUIRE(removeFromRBTree(tree, &removed[i], i % 2));
+                if (i % 100 == 0) {
+                    REQUIRE(isValidRBTree(tree->base));
+                }
+            }
+
+            THEN("only the other items remain, and the tree is still valid") {
+                std::sort(kept.begin(), kept.end());
+                REQUIRE(isValidRBTree(tree->base));
+                REQUIRE(tree->base.size == (int) kept.size());
+                REQUIRE(treeToVector(tree->base) == kept);
+                REQUIRE(freedCount == (int) removed.size() / 2);
+            }
+
+            THEN("removing them again fails") {
+                REQUIRE(!removeFromRBTree(tree, &removed[0], 1));
+                REQUIRE(tree->base.size == (int) kept.size());
+            }
+        }
+
+        WHEN("removing everything") {
+            for (auto element: elements) {
+                REQUIRE(removeFromRBTree(tree, &element, 0));
+            }
+
+            THEN("the tree is empty, and its arena gave its chunks back") {
+                REQUIRE(tree->base.root == nullptr);
+                REQUIRE(tree->base.size == 0);
+                if (tree->arena != nullptr) {
+                    REQUIRE(nodeArenaReservedBytes(tree->arena) == 0);
+                }
+            }
+        }
+
+        freeRBTreeEx(tree);
+    }
+}
+
+SCENARIO("Range scans only visit the items within the range", "[extensions][range]") {
+    GIVEN("A tree built via RBTree.h of the even numbers in [0, 1000)") {
+        std::vector<int> elements;
+        for (int i = 0; i < 1000; i += 2) {
+            elements.push_back(i);
+        }
+        std::shuffle(elements.begin(), elements.end(), std::default_random_engine {});
+        RBTree *tree = newRBTree(countingCompareInts, noFree);
+        for (auto &element: elements) {
+            REQUIRE(addToRBTree(tree, &element));
+        }
+
+        THEN("bounds are inclusive or exclusive as requested") {
+            int low = 100, high = 110;
+            std::vector<int> out;
+            REQUIRE(forEachRangeRBTree(tree, &low, 1, &high, 1, collectInts, &out));
+            REQUIRE(out == std::vector<int> {100, 102, 104, 106, 108, 110});
+            out.clear();
+            REQUIRE(forEachRangeRBTree(tree, &low, 0, &high, 0, collectInts, &out));
+            REQUIRE(out == std::vector<int> {102, 104, 106, 108});
+        }
+
+        THEN("bounds that aren't in the tree work too") {
+            int low = 101, high = 107;
+            std::vector<int> out;
+            REQUIRE(forEachRangeRBTree(tree, &low, 1, &high, 1, collectInts, &out));
+            REQUIRE(out == std::vector<int> {102, 104, 106});
+        }
+
+        THEN("NULL bounds are unbounded") {
+            int high = 4, low = 994;
+            std::vector<int> out;
+            REQUIRE(forEachRangeRBTree(tree, nullptr, 0, &high, 1, collectInts, &out));
+            REQUIRE(out == std::vector<int> {0, 2, 4});
+            out.clear();
+            REQUIRE(forEachRangeRBTree(tree, &low, 0, nullptr, 0, collectInts, &out));
+            REQUIRE(out == std::vector<int> {996, 998});
+            out.clear();
+            REQUIRE(forEachRangeRBTree(tree, nullptr, 0, nullptr, 0, collectInts, &out));
+            REQUIRE(out.size() == elements.size());
+            REQUIRE(std::is_sorted(out.begin(), out.end()));
+        }
+
+        THEN("an empty range visits nothing, with a logarithmic number of comparisons") {
+            int low = 500, high = 500;
+            std::vector<int> out;
+            comparisons = 0;
+            REQUIRE(forEachRangeRBTree(tree, &low, 0, &high, 1, collectInts, &out));
+            REQUIRE(out.empty());
+            REQUIRE(comparisons <= 2 * 10 + 1);
+        }
+
+        THEN("the scan stops once the function fails") {
+            int low = 0, high = 100;
+            int count = 0;
+            REQUIRE(!forEachRangeRBTree(tree, &low, 1, &high, 1, [](const void *, void *args) {
+                return (int) (++*(int *) args < 3);
+            }, &count));
+            REQUIRE(count == 3);
+        }
+
+        freeRBTree(tree);
+    }
+}
+
+static int valueOr(const void *data, int otherwise)
+{
+    return data != nullptr ? *(const int *) data : otherwise;
+}
+
+SCENARIO("Looking up the items nearest to a probe", "[extensions][bounds]") {
+    GIVEN("A tree built via RBTree.h of multiples of 10 in [0, 100]") {
+        std::vector<int> elements;
+        for (int i = 0; i <= 100; i += 10) {
+            elements.push_back(i);
+        }
+        std::shuffle(elements.begin(), elements.end(), std::default_random_engine {});
+        RBTree *tree = newRBTree(compareInts, noFree);
+        for (auto &element: elements) {
+            REQUIRE(addToRBTree(tree, &element));
+        }
+
+        THEN("every probe in [-5, 105] matches a linear search") {
+            for (int probe = -5; probe <= 105; probe++) {
+                CAPTURE(probe);
+                RBNeighbors neighbors;
+                bool found = neighborsRBTree(tree, &probe, &neighbors);
+                REQUIRE(found == (probe >= 0 && probe <= 100 && probe % 10 == 0));
+                int floor = -1, ceiling = -1, predecessor = -1, successor = -1;
+                for (int value = 0; value <= 100; value += 10) {
+                    if (value <= probe) floor = value;
+                    if (value < probe) predecessor = value;
+                    if (value >= probe && ceiling == -1) ceiling = value;
+                    if (value > probe && successor == -1) successor = value;
+                }
+                REQUIRE(valueOr(neighbors.floor, -1) == floor);
+                REQUIRE(valueOr(neighbors.ceiling, -1) == ceiling);
+                REQUIRE(valueOr(neighbors.predecessor, -1) == predecessor);
+                REQUIRE(valueOr(neighbors.successor, -1) == successor);
+                REQUIRE(valueOr(floorRBTree(tree, &probe), -1) == floor);
+                REQUIRE(valueOr(ceilingRBTree(tree, &probe), -1) == ceiling);
+                REQUIRE(valueOr(predecessorRBTree(tree, &probe), -1) == predecessor);
+                REQUIRE(valueOr(successorRBTree(tree, &probe), -1) == successor);
+            }
+        }
+
+        THEN("the returned pointers are the stored items themselves") {
+            int probe = 42;
+            void *ceiling = ceilingRBTree(tree, &probe);
+            REQUIRE(ceiling != nullptr);
+            REQUIRE(std::any_of(elements.begin(), elements.end(), [&](int &element) {
+                return &element == ceiling;
+            }));
+        }
+
+        freeRBTree(tree);
+    }
+}
+
+SCENARIO("Looking up a batch of probes at once", "[extensions][batch lookup]") {
+    GIVEN("A tree built via RBTree.h of the even numbers below 4000") {
+        std::vector<int> elements(2000);
+        for (int i = 0; i < 2000; i++) {
+            elements[i] = 2 * i;
+        }
+        std::shuffle(elements.begin(), elements.end(), std::default_random_engine {});
+        RBTree *tree = newRBTree(countingCompareInts, noFree);
+        for (auto &element: elements) {
+            REQUIRE(addToRBTree(tree, &element));
+        }
+        std::vector<int> values(1000);
+        std::uniform_int_distribution<int> valueOf(-10, 4010);
+        std::default_random_engine random(7);
+        for (auto &value: values) {
+            value = valueOf(random);
+        }
+        std::vector<void *> probes;
+        for (auto &value: values) {
+            probes.push_back(&value);
+        }
+
+        THEN("unsorted probes, some of them NULL, get the same answers as containsRBTree") {
+            probes[3] = nullptr;
+            probes[999] = nullptr;
+            std::vector<int> out(probes.size(), -1);
+            REQUIRE(containsManyRBTree(tree, probes.data(), probes.size(), out.data()));
+            for (size_t i = 0; i < probes.size(); i++) {
+                CAPTURE(i);
+                REQUIRE((out[i] != 0) == (probes[i] != nullptr && containsRBTree(tree, probes[i]) != 0));
+            }
+        }
+
+        THEN("sorted probes, with repeats, are merged with the tree in a linear number of comparisons") {
+            std::sort(values.begin(), values.end());
+            values[1] = values[0];
+            std::vector<int> out(probes.size(), -1);
+            comparisons = 0;
+            REQUIRE(containsManyRBTree(tree, probes.data(), probes.size(), out.data()));
+            REQUIRE(comparisons <= 2 * (int) (probes.size() + elements.size()));
+            for (size_t i = 0; i < probes.size(); i++) {
+                CAPTURE(i);
+                REQUIRE((out[i] != 0) == (containsRBTree(tree, probes[i]) != 0));
+            }
+        }
+
+        THEN("an empty batch succeeds") {
+            REQUIRE(containsManyRBTree(tree, nullptr, 0, nullptr));
+        }
+
+        freeRBTree(tree);
+    }
+}
+
+struct Product {
+    double price;
+    int id;
+};
+
+/**
+ * compares an id (the probe) with a product (a stored item) - it can't compare two products, or two ids
+ */
+static int compareIdToProduct(const void *id, const void *product) {
+    return compareInts(id, &((const Product *) product)->id);
+}
+
+static int collectProductIds(const void *product, void *args) {
+    ((std::vector<int> *) args)->push_back(((const Product *) product)->id);
+    return 1;
+}
+
+SCENARIO("Looking up probes of another type than the items", "[extensions][heterogeneous]") {
+    GIVEN("A tree of products with the even ids below 2000, compared with ids") {
+        std::vector<Product> products(1000);
+        std::vector<void *> items;
+        for (int i = 0; i < 1000; i++) {
+            products[i] = Product { i * 0.5, 2 * i };
+            items.push_back(&products[i]);
+        }
+        // the products are never compared with each other, so the tree can only be built from sorted items
+        RBTreeEx *tree = newRBTreeFromSorted(compareIdToProduct, nullptr, items.data(), items.size(), nullptr, 0);
+        REQUIRE(tree != nullptr);
+        const RBTree *base = &tree->base;
+
+        THEN("range scans, neighbors and iterators take ids") {
+            int low = 10, high = 20;
+            std::vector<int> ids;
+            REQUIRE(forEachRangeRBTree(base, &low, 0, &high, 1, collectProductIds, &ids));
+            REQUIRE(ids == std::vector<int>({12, 14, 16, 18, 20}));
+            int odd = 101, even = 100;
+            REQUIRE(floorRBTree(base, &odd) == &products[50]);
+            REQUIRE(ceilingRBTree(base, &odd) == &products[51]);
+            REQUIRE(predecessorRBTree(base, &even) == &products[49]);
+            REQUIRE(successorRBTree(base, &even) == &products[51]);
+            RBNeighbors neighbors;
+            REQUIRE(neighborsRBTree(base, &even, &neighbors));
+            REQUIRE(neighbors.floor == &products[50]);
+            RBIterator iterator;
+            REQUIRE(seekRBTree(base, &odd, &iterator) == &products[51]);
+            REQUIRE(nextRBTree(&iterator) == &products[52]);
+        }
+
+        THEN("batches of ids are looked up, whether sorted or not, few or many") {
+            std::vector<int> values(3000);
+            std::iota(values.begin(), values.end(), -500);
+            auto batchSize = GENERATE(5, 3000);
+            auto shuffled = GENERATE(0, 1);
+            CAPTURE(batchSize, shuffled);
+            values.resize(batchSize);
+            if (shuffled) {
+                std::shuffle(values.begin(), values.end(), std::default_random_engine {});
+            }
+            std::vector<void *> probes;
+            for (auto &value: values) {
+                probes.push_back(&value);
+            }
+            std::vector<int> out(probes.size(), -1);
+            REQUIRE(containsManyRBTree(base, probes.data(), probes.size(), out.data()));
+            for (size_t i = 0; i < values.size(); i++) {
+                CAPTURE(values[i]);
+                REQUIRE(out[i] == (values[i] >= 0 && values[i] < 2000 && values[i] % 2 == 0));
+            }
+        }
+
+        THEN("items are removed by id") {
+            int id = 500;
+            REQUIRE(removeFromRBTree(tree, &id, 0));
+            REQUIRE(tree->base.size == 999);
+            REQUIRE(ceilingRBTree(base, &id) == &products[251]);
+        }
+
+        freeRBTreeEx(tree);
+    }
+}
+
+SCENARIO("Order-statistic trees support rank and select", "[extensions][order statistics]") {
+    GIVEN("An order-statistic tree of the even numbers in [0, 2000), some of which were removed") {
+        std::vector<int> elements;
+        for (int i = 0; i < 2000; i += 2) {
+            elements.push_back(i);
+        }
+        auto rng = std::default_random_engine {};
+        std::shuffle(elements.begin(), elements.end(), rng);
+
+        auto useArena = GENERATE(0, 1);
+        RBTreeConfig config = { useArena, NODE_ARENA_KEEP_ALL, 1 };
+        RBTreeEx *tree = newRBTreeEx(compareInts, nullptr, &config);
+        for (auto &element: elements) {
+            REQUIRE(addToRBTreeEx(tree, &element));
+        }
+        std::vector<int> kept;
+        for (size_t i = 0; i < elements.size(); i++) {
+            if (i % 3 == 0) {
+                REQUIRE(removeFromRBTree(tree, &elements[i], 0));
+            } else {
+                kept.push_back(elements[i]);
+            }
+        }
+        std::sort(kept.begin(), kept.end());
+        REQUIRE(isValidRBTree(tree->base));
+
+        THEN("select returns the k-th smallest item") {
+            for (int k = 0; k < (int) kept.size(); k++) {
+                void *item = selectRBTree(tree, k);
+                REQUIRE(item != nullptr);
+                REQUIRE(*(int *) item == kept[k]);
+            }
+            REQUIRE(selectRBTree(tree, -1) == nullptr);
+            REQUIRE(selectRBTree(tree, (int) kept.size()) == nullptr);
+        }
+
+        THEN("rank returns the number of smaller items, whether or not the item is in the tree") {
+            for (int probe = -1; probe <= 2000; probe++) {
+                int expected = (int) (std::lower_bound(kept.begin(), kept.end(), probe) - kept.begin());
+                REQUIRE(rankRBTree(tree, &probe) == expected);
+            }
+        }
+
+        freeRBTreeEx(tree);
+    }
+
+    GIVEN("A tree that isn't in order-statistic mode") {
+        RBTreeEx *tree = newRBTreeEx(compareInts, nullptr, nullptr);
+        int element = 1;
+        REQUIRE(addToRBTreeEx(tree, &element));
+
+        THEN("rank and select fail") {
+            REQUIRE(selectRBTree(tree, 0) == nullptr);
+            REQUIRE(rankRBTree(tree, &element) == -1);
+        }
+
+        freeRBTreeEx(tree);
+    }
+}
+
+SCENARIO("Iterating over a tree in both directions", "[extensions][iterator]") {
+    GIVEN("A tree built via RBTree.h of the multiples of 3 in [0, 3000)") {
+        std::vector<int> elements;
+        for (int i = 0; i < 3000; i += 3) {
+            elements.push_back(i);
+        }
+        std::vector<int> sorted(elements);
+        std::shuffle(elements.begin(), elements.end(), std::default_random_engine {});
+        RBTree *tree = newRBTree(compareInts, noFree);
+        for (auto &element: elements) {
+            REQUIRE(addToRBTree(tree, &element));
+        }
+        RBIterator it;
+
+        THEN("walking forwards from the first item visits every item in ascending order") {
+            std::vector<int> out;
+            for (void *item = firstRBTree(tree, &it); item != nullptr; item = nextRBTree(&it)) {
+                out.push_back(*(int *) item);
+            }
+            REQUIRE(out == sorted);
+            REQUIRE(it.node == nullptr);
+            REQUIRE(nextRBTree(&it) == nullptr);
+        }
+
+        THEN("walking backwards from the last item visits every item in descending order") {
+            std::vector<int> out;
+            for (void *item = lastRBTree(tree, &it); item != nullptr; item = prevRBTree(&it)) {
+                out.push_back(*(int *) item);
+            }
+            std::reverse(out.begin(), out.end());
+            REQUIRE(out == sorted);
+        }
+
+        THEN("seeking positions the iterator at the first item not less than the probe") {
+            int probe = 1000;
+            REQUIRE(*(int *) seekRBTree(tree, &probe, &it) == 1002);
+            REQUIRE(*(int *) prevRBTree(&it) == 999);
+            REQUIRE(*(int *) nextRBTree(&it) == 1002);
+            REQUIRE(*(int *) nextRBTree(&it) == 1005);
+            probe = 999;
+            REQUIRE(*(int *) seekRBTree(tree, &probe, &it) == 999);
+            probe = 3000;
+            REQUIRE(seekRBTree(tree, &probe, &it) == nullptr);
+        }
+
+        THEN("two trees can be walked in lockstep") {
+            RBTree *other = newRBTree(compareInts, noFree);
+            std::vector<int> odds;
+            for (int i = 1; i < 100; i += 2) {
+                odds.push_back(i);
+            }
+            for (auto &odd: odds) {
+                REQUIRE(addToRBTree(other, &odd));
+            }
+            // count the common items of both trees via a merge
+            RBIterator otherIt;
+            void *a = firstRBTree(tree, &it), *b = firstRBTree(other, &otherIt);
+            int common = 0;
+            while (a != nullptr && b != nullptr) {
+                int cmp = compareInts(a, b);
+                if (cmp == 0) {
+                    ++common;
+                }
+                if (cmp <= 0) {
+                    a = nextRBTree(&it);
+                }
+                if (cmp >= 0) {
+                    b = nextRBTree(&otherIt);
+                }
+            }
+            // odd multiples of 3 below 100
+            REQUIRE(common == 17);
+            freeRBTree(other);
+        }
+
+        freeRBTree(tree);
+    }
+
+    GIVEN("An empty tree") {
+        RBTree *tree = newRBTree(compareInts, noFree);
+        RBIterator it;
+        REQUIRE(firstRBTree(tree, &it) == nullptr);
+        REQUIRE(lastRBTree(tree, &it) == nullptr);
+        REQUIRE(prevRBTree(&it) == nullptr);
+        freeRBTree(tree);
+    }
+}
+
+SCENARIO("Building a tree from sorted items", "[extensions][bulk load]") {
+    GIVEN("Sorted arrays of every size up to 300") {
+        std::vector<int> values(300);
+        std::iota(values.begin(), values.end(), 0);
+        std::vector<void *> items;
+        for (auto &value: values) {
+            items.push_back(&value);
+        }
+
+        THEN("every resulting tree is valid, holds all the items, and was built without comparisons") {
+            auto orderStatistics = GENERATE(0, 1);
+            RBTreeConfig config = { 1, NODE_ARENA_KEEP_ALL, orderStatistics };
+            for (size_t n = 0; n <= items.size(); n++) {
+                CAPTURE(n);
+                comparisons = 0;
+                RBTreeEx *tree = newRBTreeFromSorted(countingCompareInts, nullptr, items.data(), n, &config, 0);
+                REQUIRE(tree != nullptr);
+                REQUIRE(comparisons == 0);
+                REQUIRE(tree->base.size == (int) n);
+                REQUIRE(isValidRBTree(tree->base));
+                REQUIRE(treeToVector(tree->base) == std::vector<int>(values.begin(), values.begin() + n));
+                if (orderStatistics && n > 0) {
+                    REQUIRE(*(int *) selectRBTree(tree, (int) n / 3) == (int) n / 3);
+                }
+                // the tree keeps working as usual
+                int extra = -1;
+                REQUIRE(addToRBTreeEx(tree, &extra));
+                REQUIRE(removeFromRBTree(tree, &values[0], 0) == (n > 0));
+                REQUIRE(isValidRBTree(tree->base));
+                freeRBTreeEx(tree);
+            }
+        }
+
+        THEN("verifying sortedness rejects unsorted or duplicated items") {
+            RBTreeEx *tree = newRBTreeFromSorted(compareInts, nullptr, items.data(), items.size(), nullptr, 1);
+            REQUIRE(tree != nullptr);
+            freeRBTreeEx(tree);
+            std::swap(items[10], items[11]);
+            REQUIRE(newRBTreeFromSorted(compareInts, nullptr, items.data(), items.size(), nullptr, 1) == nullptr);
+            items[10] = items[11];
+            REQUIRE(newRBTreeFromSorted(compareInts, nullptr, items.data(), items.size(), nullptr, 1) == nullptr);
+        }
+    }
+}
+
+SCENARIO("Adding a batch of items at once", "[extensions][batch]") {
+    GIVEN("Trees of various sizes, and batches of various sizes with duplicates") {
+        auto treeSize = GENERATE(0, 10, 1000);
+        auto batchSize = GENERATE(1, 10, 1000, 3000);
+        auto orderStatistics = GENERATE(0, 1);
+        CAPTURE(treeSize, batchSize, orderStatistics);
+        auto rng = std::default_random_engine {};
+        auto valueGen = std::uniform_int_distribution<int>(0, 4000);
+
+        std::vector<int> initial(treeSize), batch(batchSize);
+        std::generate(initial.begin(), initial.end(), [&]() { return valueGen(rng); });
+        std::generate(batch.begin(), batch.end(), [&]() { return valueGen(rng); });
+
+        RBTreeConfig config = { 0, 0, orderStatistics };
+        RBTreeEx *tree = newRBTreeEx(countingCompareInts, nullptr, &config);
+        std::set<int> expected;
+        for (auto &value: initial) {
+            REQUIRE(addToRBTreeEx(tree, &value) == expected.insert(value).second);
+        }
+        std::vector<int> expectedResults;
+        for (auto value: batch) {
+            expectedResults.push_back(expected.insert(value).second);
+        }
+
+        WHEN("adding the batch") {
+            std::vector<void *> items;
+            for (auto &value: batch) {
+                items.push_back(&value);
+            }
+            std::vector<int> results(batch.size(), -1);
+            comparisons = 0;
+            REQUIRE(addManyToRBTree(tree, items.data(), items.size(), results.data()));
+
+            THEN("the tree holds the union, and the results match adding the items one by one") {
+                REQUIRE(isValidRBTree(tree->base));
+                REQUIRE(tree->base.size == (int) expected.size());
+                REQUIRE(treeToVector(tree->base) == std::vector<int>(expected.begin(), expected.end()));
+                REQUIRE(results == expectedResults);
+                if (orderStatistics) {
+                    REQUIRE(*(int *) selectRBTree(tree, tree->base.size / 2) ==
+                            *std::next(expected.begin(), tree->base.size / 2));
+                }
+            }
+
+            THEN("the items that were added are the ones that are stored") {
+                for (size_t i = 0; i < batch.size(); i++) {
+                    if (results[i]) {
+                        REQUIRE(ceilingRBTree(&tree->base, &batch[i]) == &batch[i]);
+                    }
+                }
+            }
+        }
+
+        freeRBTreeEx(tree);
+    }
+
+    GIVEN("A large tree and a small sorted batch right after its items") {
+        std::vector<int> values(100000);
+        std::iota(values.begin(), values.end(), 0);
+        RBTreeEx *tree = newRBTreeEx(countingCompareInts, nullptr, nullptr);
+        for (auto &value: values) {
+            REQUIRE(addToRBTreeEx(tree, &value));
+        }
+        std::vector<int> batch(100);
+        std::iota(batch.begin(), batch.end(), 50000);
+        std::transform(batch.begin(), batch.end(), batch.begin(), [](int value) { return value * 2 + 1; });
+        std::vector<void *> items;
+        for (auto &value: batch) {
+            items.push_back(&value);
+        }
+
+        THEN("each item costs far fewer comparisons than a full descent") {
+            comparisons = 0;
+            REQUIRE(addManyToRBTree(tree, items.data(), items.size(), nullptr));
+            // sorting 100 items takes < 700 comparisons, descending from the root takes ~17 per item
+            REQUIRE(comparisons < 700 + 100 * 12);
+            REQUIRE(isValidRBTree(tree->base));
+        }
+
+        freeRBTreeEx(tree);
+    }
+}
+
+SCENARIO("Adding items next to a hint node", "[extensions][hint]") {
+    GIVEN("An empty tree") {
+        auto orderStatistics = GENERATE(0, 1);
+        CAPTURE(orderStatistics);
+        RBTreeConfig config = { 1, NODE_ARENA_KEEP_ALL, orderStatistics };
+        RBTreeEx *tree = newRBTreeEx(countingCompareInts, nullptr, &config);
+        std::vector<int> values(10000);
+        std::iota(values.begin(), values.end(), 0);
+
+        WHEN("adding sorted items, each with the previous one's node as the hint") {
+            comparisons = 0;
+            Node *hint = nullptr;
+            for (auto &value: values) {
+                hint = addToRBTreeHint(tree, &value, hint);
+                REQUIRE(hint != nullptr);
+                REQUIRE(hint->data == &value);
+            }
+
+            THEN("it costs a constant number of comparisons per item") {
+                // a full descent would cost ~14 per item
+                REQUIRE(comparisons <= 4 * (int) values.size());
+                REQUIRE(isValidRBTree(tree->base));
+                REQUIRE(treeToVector(tree->base) == values);
+                if (orderStatistics) {
+                    REQUIRE(*(int *) selectRBTree(tree, 1234) == 1234);
+                }
+            }
+
+            THEN("adding an item that is already there fails, whatever the hint") {
+                int duplicate = 5000;
+                REQUIRE(addToRBTreeHint(tree, &duplicate, nullptr) == nullptr);
+                REQUIRE(addToRBTreeHint(tree, &duplicate, hint) == nullptr);
+                REQUIRE(tree->base.size == (int) values.size());
+            }
+        }
+
+        WHEN("adding nearly sorted items, and items far from their hint") {
+            auto rng = std::default_random_engine {};
+            for (size_t i = 0; i + 4 < values.size(); i += 4) {
+                std::shuffle(values.begin() + i, values.begin() + i + 4, rng);
+            }
+            Node *hint = nullptr;
+            for (auto &value: values) {
+                hint = addToRBTreeHint(tree, &value, hint);
+                REQUIRE(hint != nullptr);
+            }
+            std::vector<int> far = { -1, 20000, -2, 15000 };
+            for (auto &value: far) {
+                hint = addToRBTreeHint(tree, &value, hint);
+                REQUIRE(hint != nullptr);
+            }
+
+            THEN("the tree holds every item in order") {
+                REQUIRE(isValidRBTree(tree->base));
+                std::vector<int> expected(values);
+                expected.insert(expected.end(), far.begin(), far.end());
+                std::sort(expected.begin(), expected.end());
+                REQUIRE(treeToVector(tree->base) == expected);
+            }
+        }
+
+        freeRBTreeEx(tree);
+    }
+}
+
+SCENARIO("Splitting and joining trees", "[extensions][join]") {
+    GIVEN("A tree of 1000 shuffled integers") {
+        std::vector<int> elements(1000);
+        std::iota(elements.begin(), elements.end(), 0);
+        std::shuffle(elements.begin(), elements.end(), std::default_random_engine {});
+        auto useArena = GENERATE(0, 1);
+        auto orderStatistics = GENERATE(0, 1);
+        RBTreeConfig config = { useArena, 1, orderStatistics };
+        RBTreeEx *tree = newRBTreeEx(compareInts, countFree, &config);
+        for (auto &element: elements) {
+            REQUIRE(addToRBTreeEx(tree, &element));
+        }
+        freedCount = 0;
+
+        THEN("splitting at any pivot yields valid trees of the smaller and the other items, which join back") {
+            for (int pivot: {-5, 0, 1, 250, 499, 500, 998, 999, 1000, 2000}) {
+                CAPTURE(pivot);
+                RBTreeEx *left, *right;
+                REQUIRE(splitRBTree(tree, &pivot, &left, &right));
+                int expectedLeft = std::max(0, std::min(pivot, 1000));
+                REQUIRE(left->base.size == expectedLeft);
+                REQUIRE(right->base.size == 1000 - expectedLeft);
+                REQUIRE(isValidRBTree(left->base));
+                REQUIRE(isValidRBTree(right->base));
+                std::vector<int> lefts = treeToVector(left->base), rights = treeToVector(right->base);
+                REQUIRE((int) lefts.size() == expectedLeft);
+                REQUIRE(std::all_of(lefts.begin(), lefts.end(), [&](int value) { return value < pivot; }));
+                REQUIRE(std::all_of(rights.begin(), rights.end(), [&](int value) { return value >= pivot; }));
+                if (orderStatistics && right->base.size > 0) {
+                    REQUIRE(*(int *) selectRBTree(right, 0) == std::max(pivot, 0));
+                }
+
+                // joining in the wrong order is rejected
+                if (left->base.size > 0 && right->base.size > 0) {
+                    REQUIRE(joinRBTree(right, left) == nullptr);
+                }
+                tree = joinRBTree(left, right);
+                REQUIRE(tree != nullptr);
+                REQUIRE(tree->base.size == 1000);
+                REQUIRE(isValidRBTree(tree->base));
+            }
+            std::vector<int> sorted(elements);
+            std::sort(sorted.begin(), sorted.end());
+            REQUIRE(treeToVector(tree->base) == sorted);
+            REQUIRE(freedCount == 0);
+        }
+
+        THEN("a key range can be dropped by splitting twice") {
+            int low = 100, high = 200;
+            RBTreeEx *below, *rest, *range, *above;
+            REQUIRE(splitRBTree(tree, &low, &below, &rest));
+            REQUIRE(splitRBTree(rest, &high, &range, &above));
+            REQUIRE(range->base.size == 100);
+            freeRBTreeEx(range);
+            REQUIRE(freedCount == 100);
+            tree = joinRBTree(below, above);
+            REQUIRE(tree != nullptr);
+            REQUIRE(tree->base.size == 900);
+            REQUIRE(isValidRBTree(tree->base));
+            REQUIRE(!containsRBTree(&tree->base, &low));
+            REQUIRE(containsRBTree(&tree->base, &high));
+        }
+
+        freeRBTreeEx(tree);
+    }
+
+    GIVEN("Trees of very different heights") {
+        std::vector<int> values(5000);
+        std::iota(values.begin(), values.end(), 0);
+        RBTreeEx *small = newRBTreeEx(compareInts, nullptr, nullptr);
+        RBTreeEx *large = newRBTreeEx(compareInts, nullptr, nullptr);
+        for (int i = 0; i < 3; i++) {
+            REQUIRE(addToRBTreeEx(small, &values[i]));
+        }
+        for (int i = 3; i < 5000; i++) {
+            REQUIRE(addToRBTreeEx(large, &values[i]));
+        }
+
+        THEN("they aren't joined if their FreeFuncs differ") {
+            large->base.freeFunc = countFree;
+            REQUIRE(joinRBTree(small, large) == nullptr);
+            large->base.freeFunc = nullptr;
+            freeRBTreeEx(small);
+            freeRBTreeEx(large);
+        }
+
+        THEN("they join into a valid tree") {
+            RBTreeEx *joined = joinRBTree(small, large);
+            REQUIRE(joined != nullptr);
+            REQUIRE(joined->base.size == 5000);
+            REQUIRE(isValidRBTree(joined->base));
+            REQUIRE(treeToVector(joined->base) == values);
+            freeRBTreeEx(joined);
+        }
+    }
+}
+
+SCENARIO("Union, intersection and difference of trees", "[extensions][sets]") {
+    GIVEN("Two overlapping trees of random integers") {
+        auto sizes = GENERATE(std::make_pair(0, 100), std::make_pair(100, 0), std::make_pair(30, 20000),
+                              std::make_pair(20000, 30), std::make_pair(20000, 15000));
+        auto threads = GENERATE(1u, 4u);
+        auto useArena = GENERATE(0, 1);
+        auto orderStatistics = GENERATE(0, 1);
+        CAPTURE(sizes.first, sizes.second, threads, useArena, orderStatistics);
+        std::default_random_engine engine(sizes.first + sizes.second);
+        std::uniform_int_distribution<int> distribution(0, 40000);
+        std::vector<int> firstItems(sizes.first), secondItems(sizes.second);
+        std::generate(firstItems.begin(), firstItems.end(), [&]() { return distribution(engine); });
+        std::generate(secondItems.begin(), secondItems.end(), [&]() { return distribution(engine); });
+
+        RBTreeConfig config = { useArena, 1, orderStatistics };
+        RBTreeEx *first = newRBTreeEx(compareInts, countFree, &config);
+        RBTreeEx *second = newRBTreeExLike(first);
+        std::set<int> firstSet, secondSet;
+        for (auto &item: firstItems) {
+            REQUIRE(addToRBTreeEx(first, &item) == firstSet.insert(item).second);
+        }
+        for (auto &item: secondItems) {
+            REQUIRE(addToRBTreeEx(second, &item) == secondSet.insert(item).second);
+        }
+        auto firstOwns = [&](const int *item) { return item >= firstItems.data() && item < firstItems.data() +
+                                                                                      firstItems.size(); };
+        std::vector<int> both, either, onlyFirst;
+        std::set_intersection(firstSet.begin(), firstSet.end(), secondSet.begin(), secondSet.end(),
+                              std::back_inserter(both));
+        std::set_union(firstSet.begin(), firstSet.end(), secondSet.begin(), secondSet.end(),
+                       std::back_inserter(either));
+        std::set_difference(firstSet.begin(), firstSet.end(), secondSet.begin(), secondSet.end(),
+                            std::back_inserter(onlyFirst));
+        freedCount = 0;
+        RBTreeEx *result = nullptr;
+        size_t totalSize = firstSet.size() + secondSet.size();
+
+        THEN("the union holds the items of both, keeping the chosen side's duplicates") {
+            auto keepSecond = GENERATE(0, 1);
+            RBSetPolicy policy = { keepSecond, 1, threads };
+            result = unionRBTree(first, second, &policy);
+            REQUIRE(result == first);
+            REQUIRE(isValidRBTree(result->base));
+            REQUIRE(treeToVector(result->base) == either);
+            REQUIRE(result->base.size == (int) either.size());
+            REQUIRE(freedCount == (int) (totalSize - either.size()));
+            for (int value: both) {
+                RBIterator iterator;
+                const int *kept = (const int *) seekRBTree(&result->base, &value, &iterator);
+                REQUIRE(firstOwns(kept) == !keepSecond);
+            }
+        }
+
+        THEN("the intersection holds the items in both") {
+            RBSetPolicy policy = { 1, 1, threads };
+            result = intersectRBTree(first, second, &policy);
+            REQUIRE(isValidRBTree(result->base));
+            REQUIRE(treeToVector(result->base) == both);
+            REQUIRE(result->base.size == (int) both.size());
+            REQUIRE(freedCount == (int) (totalSize - both.size()));
+            RBIterator iterator;
+            for (void *item = firstRBTree(&result->base, &iterator); item != nullptr; item = nextRBTree(&iterator)) {
+                REQUIRE(!firstOwns((const int *) item));
+            }
+        }
+
+        THEN("the difference holds the items only in the first") {
+            RBSetPolicy policy = { 0, 0, threads };
+            result = differenceRBTree(first, second, &policy);
+            REQUIRE(isValidRBTree(result->base));
+            REQUIRE(treeToVector(result->base) == onlyFirst);
+            REQUIRE(result->base.size == (int) onlyFirst.size());
+            REQUIRE(freedCount == 0);
+        }
+
+        if (orderStatistics && result->base.size > 0) {
+            REQUIRE(*(int *) selectRBTree(result, result->base.size - 1) == *std::prev(treeToVector(result->base).end()));
+        }
+        freedCount = 0;
+        int expectedFreed = result->base.size;
+        freeRBTreeEx(result);
+        REQUIRE(freedCount == expectedFreed);
+    }
+
+    GIVEN("Trees that don't share an arena") {
+        RBTreeConfig config = { 1, 1, 0 };
+        RBTreeEx *first = newRBTreeEx(compareInts, nullptr, &config);
+        RBTreeEx *second = newRBTreeEx(compareInts, nullptr, &config);
+        THEN("they can't be combined in place") {
+            REQUIRE(unionRBTree(first, second, nullptr) == nullptr);
+            REQUIRE(intersectRBTree(first, first, nullptr) == nullptr);
+        }
+        freeRBTreeEx(first);
+        freeRBTreeEx(second);
+    }
+
+    GIVEN("Two independently built trees of overlapping integers") {
+        auto threads = GENERATE(1u, 4u);
+        auto resultArena = GENERATE(0, 1);
+        auto resultOrderStatistics = GENERATE(0, 1);
+        CAPTURE(threads, resultArena, resultOrderStatistics);
+        std::vector<int> firstItems(3000), secondItems(2000);
+        std::iota(firstItems.begin(), firstItems.end(), 0);
+        std::iota(secondItems.begin(), secondItems.end(), 2000);
+        RBTreeConfig arena = { 1, 1, 0 }, counted = { 0, 0, 1 };
+        RBTreeEx *first = newRBTreeEx(compareInts, countFree, &arena);
+        RBTreeEx *second = newRBTreeEx(compareInts, countFree, &counted);
+        for (auto &item: firstItems) {
+            REQUIRE(addToRBTreeEx(first, &item));
+        }
+        for (auto &item: secondItems) {
+            REQUIRE(addToRBTreeEx(second, &item));
+        }
+        RBTreeConfig config = { resultArena, 1, resultOrderStatistics };
+        RBSetPolicy policy = { 1, 1, threads };
+        freedCount = 0;
+
+        WHEN("making their union, intersection and difference as new trees") {
+            RBTreeEx *either = newUnionRBTree(&first->base, &second->base, &config, &policy);
+            RBTreeEx *both = newIntersectionRBTree(&first->base, &second->base, &config, &policy);
+            RBTreeEx *onlyFirst = newDifferenceRBTree(&first->base, &second->base, &config, &policy);
+            REQUIRE(either != nullptr);
+            REQUIRE(both != nullptr);
+            REQUIRE(onlyFirst != nullptr);
+
+            THEN("the new trees hold the right items, and the two trees are left intact") {
+                for (RBTreeEx *result: {either, both, onlyFirst}) {
+                    REQUIRE(isValidRBTree(result->base));
+                    REQUIRE(result->arena != first->arena);
+                    REQUIRE(result->orderStatistics == resultOrderStatistics);
+                }
+                std::vector<int> expected(4000);
+                std::iota(expected.begin(), expected.end(), 0);
+                REQUIRE(treeToVector(either->base) == expected);
+                REQUIRE(treeToVector(both->base) == std::vector<int>(firstItems.begin() + 2000, firstItems.end()));
+                REQUIRE(treeToVector(onlyFirst->base) == std::vector<int>(firstItems.begin(), firstItems.begin() + 2000));
+                RBIterator iterator;
+                REQUIRE(seekRBTree(&both->base, &firstItems[2500], &iterator) == &secondItems[500]);
+                if (resultOrderStatistics) {
+                    REQUIRE(*(int *) selectRBTree(either, 3210) == 3210);
+                }
+                REQUIRE(freedCount == 0);
+                REQUIRE(isValidRBTree(first->base));
+                REQUIRE(isValidRBTree(second->base));
+                REQUIRE(treeToVector(first->base) == firstItems);
+                REQUIRE(treeToVector(second->base) == secondItems);
+            }
+
+            freeRBTreeEx(either);
+            freeRBTreeEx(both);
+            freeRBTreeEx(onlyFirst);
+            REQUIRE(freedCount == 0);
+        }
+
+        THEN("a tree can be combined with itself, but not into an intrusive tree") {
+            RBTreeEx *same = newIntersectionRBTree(&first->base, &first->base, &config, nullptr);
+            REQUIRE(same != nullptr);
+            REQUIRE(treeToVector(same->base) == firstItems);
+            freeRBTreeEx(same);
+            RBTreeConfig intrusive = { 0, 0, 0, 1, 0 };
+            REQUIRE(newUnionRBTree(&first->base, &second->base, &intrusive, nullptr) == nullptr);
+        }
+
+        freeRBTreeEx(first);
+        freeRBTreeEx(second);
+        REQUIRE(freedCount == 5000);
+    }
+}
+
+struct OrderedRun {
+    int first, last, count;
+    bool ascending;
+};
+
+static void mapOrderedRun(const void *item, void *accumulator, void *) {
+    auto run = (OrderedRun *) accumulator;
+    int value = *(const int *) item;
+    if (run->count == 0) {
+        run->first = value;
+    } else if (run->last >= value) {
+        run->ascending = false;
+    }
+    run->last = value;
+    run->count++;
+}
+
+static void combineOrderedRuns(void *accumulator, const void *other, void *) {
+    auto run = (OrderedRun *) accumulator;
+    auto next = (const OrderedRun *) other;
+    if (next->count == 0) {
+        return;
+    }
+    if (run->count == 0) {
+        *run = *next;
+        return;
+    }
+    run->ascending = run->ascending && next->ascending && run->last < next->first;
+    run->last = next->last;
+    run->count += next->count;
+}
+
+static void mapInverse(const void *item, void *accumulator, void *) {
+    *(double *) accumulator += 1.0 / (1 + *(const int *) item);
+}
+
+static void combineSums(void *accumulator, const void *other, void *) {
+    *(double *) accumulator += *(const double *) other;
+}
+
+static void mapIntSum(const void *item, void *accumulator, void *args) {
+    *(long long *) accumulator += *(const int *) item;
+    (*(int *) args)++;
+}
+
+static void combineIntSums(void *accumulator, const void *other, void *) {
+    *(long long *) accumulator += *(const long long *) other;
+}
+
+SCENARIO("Reducing a tree on several threads", "[extensions][reduce]") {
+    GIVEN("A tree of 100000 shuffled integers") {
+        std::vector<int> elements(100000);
+        std::iota(elements.begin(), elements.end(), 0);
+        std::shuffle(elements.begin(), elements.end(), std::default_random_engine {});
+        RBTreeConfig config = { 1, 1, 0 };
+        RBTreeEx *tree = newRBTreeEx(compareInts, nullptr, &config);
+        for (auto &element: elements) {
+            REQUIRE(addToRBTreeEx(tree, &element));
+        }
+        auto threads = GENERATE(0u, 1u, 2u, 8u);
+        CAPTURE(threads);
+
+        THEN("the items are combined in ascending order") {
+            OrderedRun identity = { 0, 0, 0, true }, run;
+            RBReducer reducer = { sizeof(OrderedRun), &identity, mapOrderedRun, combineOrderedRuns, nullptr };
+            REQUIRE(reduceRBTree(&tree->base, &reducer, &run, threads));
+            REQUIRE(run.ascending);
+            REQUIRE(run.count == 100000);
+            REQUIRE(run.first == 0);
+            REQUIRE(run.last == 99999);
+        }
+
+        THEN("the result doesn't depend on the number of threads") {
+            double zero = 0, sequential, parallel;
+            RBReducer reducer = { sizeof(double), &zero, mapInverse, combineSums, nullptr };
+            REQUIRE(reduceRBTree(&tree->base, &reducer, &sequential, 1));
+            REQUIRE(reduceRBTree(&tree->base, &reducer, &parallel, threads));
+            REQUIRE(std::memcmp(&sequential, &parallel, sizeof(double)) == 0);
+        }
+
+        freeRBTreeEx(tree);
+    }
+
+    GIVEN("A tree built by RBTree.h") {
+        RBTree *tree = newRBTree(compareInts, noFree);
+        std::vector<int> elements(5000);
+        std::iota(elements.begin(), elements.end(), 1);
+        for (auto &element: elements) {
+            REQUIRE(addToRBTree(tree, &element));
+        }
+
+        THEN("it can be reduced as well") {
+            long long zero = 0, sum;
+            int calls = 0;
+            RBReducer reducer = { sizeof(long long), &zero, mapIntSum, combineIntSums, &calls };
+            REQUIRE(reduceRBTree(tree, &reducer, &sum, 1));
+            REQUIRE(sum == 5000LL * 5001 / 2);
+            REQUIRE(calls == 5000);
+        }
+
+        THEN("an empty reduction yields the identity") {
+            RBTree *empty = newRBTree(compareInts, noFree);
+            long long identity = 7, sum = 0;
+            int calls = 0;
+            RBReducer reducer = { sizeof(long long), &identity, mapIntSum, combineIntSums, &calls };
+            REQUIRE(reduceRBTree(empty, &reducer, &sum, 4));
+            REQUIRE(sum == 7);
+            freeRBTree(empty);
+        }
+
+        freeRBTree(tree);
+    }
+}
+
+SCENARIO("Reading a concurrent tree while it's written to", "[extensions][concurrent]") {
+    GIVEN("A concurrent tree holding the even numbers below 20000") {
+        std::vector<int> values(40000);
+        std::iota(values.begin(), values.end(), 0);
+        ConcurrentRBTree *tree = newConcurrentRBTree(compareInts, nullptr);
+        for (int i = 0; i < 20000; i += 2) {
+            REQUIRE(addToConcurrentRBTree(tree, &values[i]));
+        }
+
+        THEN("readers keep finding every even number while a writer adds all the odd ones and more") {
+            std::vector<int> misses(4, 0), spurious(4, 0);
+            std::vector<std::thread> readers;
+            for (int reader = 0; reader < 4; reader++) {
+                readers.emplace_back([&, reader]() {
+                    for (int round = 0; round < 5; round++) {
+                        for (int i = 0; i < 20000; i++) {
+                            bool found = containsConcurrentRBTree(tree, &values[i]);
+                            if (i % 2 == 0 && !found) {
+                                misses[reader]++;
+                            }
+                        }
+                        // nothing at or above 40000 is ever added
+                        int absent = 40000 + round;
+                        spurious[reader] += containsConcurrentRBTree(tree, &absent);
+                    }
+                });
+            }
+            int added = 0;
+            for (int i = 1; i < 20000; i += 2) {
+                added += addToConcurrentRBTree(tree, &values[i]);
+            }
+            for (int i = 20000; i < 40000; i++) {
+                added += addToConcurrentRBTree(tree, &values[i]);
+            }
+            for (auto &reader: readers) {
+                reader.join();
+            }
+            REQUIRE(std::accumulate(misses.begin(), misses.end(), 0) == 0);
+            REQUIRE(std::accumulate(spurious.begin(), spurious.end(), 0) == 0);
+            REQUIRE(added == 30000);
+            REQUIRE(sizeOfConcurrentRBTree(tree) == 40000);
+            REQUIRE(!addToConcurrentRBTree(tree, &values[123]));
+
+            std::vector<int> items;
+            REQUIRE(forEachConcurrentRBTree(tree, collectInts, &items));
+            REQUIRE(items == values);
+        }
+
+        freeConcurrentRBTree(tree);
+    }
+}
+
+SCENARIO("Snapshots of a persistent tree don't change", "[extensions][persistent]") {
+    GIVEN("A persistent tree that snapshots are taken of while adding shuffled integers") {
+        std::vector<int> elements(5000);
+        std::iota(elements.begin(), elements.end(), 0);
+        std::shuffle(elements.begin(), elements.end(), std::default_random_engine {});
+        freedCount = 0;
+        PersistentRBTree *tree = newPersistentRBTree(compareInts, countFree);
+        std::vector<RBSnapshot *> snapshots;
+        std::vector<std::vector<int>> expected;
+        std::set<int> added;
+        for (size_t i = 0; i < elements.size(); i++) {
+            if (i % 500 == 0) {
+                snapshots.push_back(snapshotRBTree(tree));
+                expected.emplace_back(added.begin(), added.end());
+            }
+            REQUIRE(addToPersistentRBTree(tree, &elements[i]));
+            added.insert(elements[i]);
+        }
+        REQUIRE(!addToPersistentRBTree(tree, &elements[0]));
+
+        THEN("every snapshot still holds exactly the items that were in the tree when it was taken") {
+            REQUIRE(sizeOfPersistentRBTree(tree) == 5000);
+            for (size_t i = 0; i < snapshots.size(); i++) {
+                std::vector<int> items;
+                REQUIRE(forEachRBSnapshot(snapshots[i], collectInts, &items));
+                REQUIRE(items == expected[i]);
+                REQUIRE(sizeOfRBSnapshot(snapshots[i]) == (int) expected[i].size());
+                int later = elements[i * 500];
+                REQUIRE(!containsRBSnapshot(snapshots[i], &later));
+                REQUIRE(containsPersistentRBTree(tree, &later));
+            }
+            std::vector<int> items;
+            REQUIRE(forEachPersistentRBTree(tree, collectInts, &items));
+            REQUIRE(items == std::vector<int>(added.begin(), added.end()));
+        }
+
+        THEN("snapshots can be read on another thread while the tree changes") {
+            RBSnapshot *snapshot = snapshotRBTree(tree);
+            std::vector<int> more(5000);
+            std::iota(more.begin(), more.end(), 5000);
+            std::vector<int> items;
+            std::thread reader([&]() {
+                for (int round = 0; round < 3; round++) {
+                    items.clear();
+                    forEachRBSnapshot(snapshot, collectInts, &items);
+                }
+            });
+            for (auto &item: more) {
+                REQUIRE(addToPersistentRBTree(tree, &item));
+            }
+            reader.join();
+            REQUIRE(items == std::vector<int>(added.begin(), added.end()));
+            releaseRBSnapshot(snapshot);
+            REQUIRE(sizeOfPersistentRBTree(tree) == 10000);
+        }
+
+        // releasing in any order frees exactly the nodes nothing else holds (checked by the sanitizers / valgrind)
+        std::shuffle(snapshots.begin(), snapshots.end(), std::default_random_engine {});
+        for (auto snapshot: snapshots) {
+            releaseRBSnapshot(snapshot);
+        }
+        REQUIRE(freedCount == 0);
+        int size = sizeOfPersistentRBTree(tree);
+        freePersistentRBTree(tree);
+        REQUIRE(freedCount == size);
+    }
+}
+
+SCENARIO("Adding to a skip list from several threads", "[extensions][skip list]") {
+    GIVEN("An empty skip list") {
+        freedCount = 0;
+        std::vector<int> values(20000);
+        std::iota(values.begin(), values.end(), 0);
+        SkipList *list = newSkipList(compareProbeToStored, countFree);
+
+        THEN("it behaves like a RBTree on a single thread") {
+            std::vector<int> shuffled(values);
+            std::shuffle(shuffled.begin(), shuffled.end(), std::default_random_engine {});
+            storedBegin = shuffled.data();
+            storedEnd = shuffled.data() + shuffled.size();
+            misorderedComparisons = 0;
+            for (auto &value: shuffled) {
+                REQUIRE(addToSkipList(list, &value));
+            }
+            REQUIRE(!addToSkipList(list, &values[5]));
+            REQUIRE(sizeOfSkipList(list) == 20000);
+            int absent = -1;
+            REQUIRE(!containsSkipList(list, &absent));
+            REQUIRE(containsSkipList(list, &values[19999]));
+            REQUIRE(misorderedComparisons == 0);
+            std::vector<int> items;
+            REQUIRE(forEachSkipList(list, collectInts, &items));
+            REQUIRE(items == values);
+        }
+
+        THEN("every item is added exactly once when threads add overlapping ranges") {
+            storedBegin = values.data();
+            storedEnd = values.data() + values.size();
+            std::vector<int> added(8, 0);
+            std::vector<std::thread> producers;
+            for (int producer = 0; producer < 8; producer++) {
+                producers.emplace_back([&, producer]() {
+                    // producers 2k and 2k + 1 race on the same quarter of the values
+                    int quarter = producer / 2;
+                    for (int i = quarter * 5000; i < (quarter + 1) * 5000; i++) {
+                        added[producer] += addToSkipList(list, &values[i]);
+                    }
+                });
+            }
+            for (auto &producer: producers) {
+                producer.join();
+            }
+            REQUIRE(std::accumulate(added.begin(), added.end(), 0) == 20000);
+            REQUIRE(sizeOfSkipList(list) == 20000);
+            std::vector<int> items;
+            REQUIRE(forEachSkipList(list, collectInts, &items));
+            REQUIRE(items == values);
+        }
+
+        freeSkipList(list);
+        REQUIRE(freedCount == 20000);
+    }
+}
+
+/**
+ * Checks parent links, ordering and the RB properties of a subtree of CompactNodes
+ * @return black height of the subtree, or -1 if it's invalid
+ */
+static int checkCompactSubtree(const CompactRBTree &tree, const CompactNode *node, const CompactNode *parent)
+{
+    if (node == nullptr) {
+        return 1;
+    }
+    if (COMPACT_PARENT(node) != parent) {
+        return -1;
+    }
+    if (COMPACT_COLOR(node) == RED && parent != nullptr && COMPACT_COLOR(parent) == RED) {
+        return -1;
+    }
+    if ((node->left != nullptr && tree.compFunc(node->left->data, node->data) >= 0) ||
+        (node->right != nullptr && tree.compFunc(node->right->data, node->data) <= 0)) {
+        return -1;
+    }
+    int left = checkCompactSubtree(tree, node->left, node);
+    int right = checkCompactSubtree(tree, node->right, node);
+    if (left < 0 || left != right) {
+        return -1;
+    }
+    return left + (COMPACT_COLOR(node) == BLACK);
+}
+
+SCENARIO("Compact trees keep the color within the parent pointer", "[extensions][compact]") {
+    GIVEN("A compact tree of 10000 shuffled integers") {
+        REQUIRE(sizeof(CompactNode) == 4 * sizeof(void *));
+        std::vector<int> elements(10000);
+        std::iota(elements.begin(), elements.end(), 0);
+        std::vector<int> shuffled(elements);
+        std::shuffle(shuffled.begin(), shuffled.end(), std::default_random_engine {});
+        freedCount = 0;
+        CompactRBTree *tree = newCompactRBTree(compareInts, countFree);
+        for (auto &element: shuffled) {
+            REQUIRE(addToCompactRBTree(tree, &element));
+        }
+
+        THEN("it is a valid RB tree holding all the items") {
+            REQUIRE(!addToCompactRBTree(tree, &shuffled[42]));
+            REQUIRE(tree->size == 10000);
+            REQUIRE(COMPACT_COLOR(tree->root) == BLACK);
+            REQUIRE(checkCompactSubtree(*tree, tree->root, nullptr) > 0);
+            std::vector<int> items;
+            REQUIRE(forEachCompactRBTree(tree, collectInts, &items));
+            REQUIRE(items == elements);
+            int absent = 10000;
+            REQUIRE(containsCompactRBTree(tree, &elements[9999]));
+            REQUIRE(!containsCompactRBTree(tree, &absent));
+        }
+
+        THEN("the visualizer draws it like a regular tree") {
+            CompactRBTree *small = newCompactRBTree(compareInts, nullptr);
+            for (int i = 0; i < 3; i++) {
+                REQUIRE(addToCompactRBTree(small, &elements[i]));
+            }
+            std::stringstream dot;
+            std::map<const void *, std::pair<std::string, int>> tags;
+            int counter = 0;
+            treeToDot(*small->root, "compact", counter, dot, tags, intFormatter, false, true);
+            std::string drawn = dot.str();
+            REQUIRE(drawn.find("color=black label=\"{1}\"") != std::string::npos);
+            REQUIRE(drawn.find("color=red label=\"{0}\"") != std::string::npos);
+            REQUIRE(drawn.find("color=red label=\"{2}\"") != std::string::npos);
+            freeCompactRBTree(small);
+        }
+
+        freeCompactRBTree(tree);
+        REQUIRE(freedCount == 10000);
+    }
+}
+
+static int checkIndexedSubtree(const IndexedRBTree &tree, uint32_t node, uint32_t parent)
+{
+    if (node == INDEXED_NONE) {
+        return 1;
+    }
+    const IndexedNode *nodes = tree.nodes;
+    if (INDEXED_PARENT(&nodes[node]) != parent) {
+        return -1;
+    }
+    if (INDEXED_COLOR(&nodes[node]) == RED && parent != INDEXED_NONE && INDEXED_COLOR(&nodes[parent]) == RED) {
+        return -1;
+    }
+    if ((nodes[node].left != INDEXED_NONE && tree.compFunc(tree.items[nodes[node].left], tree.items[node]) >= 0) ||
+        (nodes[node].right != INDEXED_NONE && tree.compFunc(tree.items[nodes[node].right], tree.items[node]) <= 0)) {
+        return -1;
+    }
+    int left = checkIndexedSubtree(tree, nodes[node].left, node);
+    int right = checkIndexedSubtree(tree, nodes[node].right, node);
+    if (left < 0 || left != right) {
+        return -1;
+    }
+    return left + (INDEXED_COLOR(&nodes[node]) == BLACK);
+}
+
+SCENARIO("Indexed trees link their nodes by 32 bit indices", "[extensions][indexed]") {
+    GIVEN("An indexed tree of 10000 shuffled integers") {
+        REQUIRE(sizeof(IndexedNode) == 12);
+        std::vector<int> elements(10000);
+        std::iota(elements.begin(), elements.end(), 0);
+        std::vector<int> shuffled(elements);
+        std::shuffle(shuffled.begin(), shuffled.end(), std::default_random_engine {});
+        freedCount = 0;
+        IndexedRBTree *tree = newIndexedRBTree(compareInts, countFree);
+        for (auto &element: shuffled) {
+            REQUIRE(addToIndexedRBTree(tree, &element));
+        }
+
+        THEN("it is a valid RB tree holding all the items") {
+            REQUIRE(!addToIndexedRBTree(tree, &shuffled[42]));
+            REQUIRE(tree->size == 10000);
+            REQUIRE(INDEXED_COLOR(&tree->nodes[tree->root]) == BLACK);
+            REQUIRE(checkIndexedSubtree(*tree, tree->root, INDEXED_NONE) > 0);
+            std::vector<int> items;
+            REQUIRE(forEachIndexedRBTree(tree, collectInts, &items));
+            REQUIRE(items == elements);
+            int absent = 10000;
+            REQUIRE(containsIndexedRBTree(tree, &elements[9999]));
+            REQUIRE(!containsIndexedRBTree(tree, &absent));
+        }
+
+        WHEN("copying it, and adding to the copy") {
+            IndexedRBTree *copy = copyIndexedRBTree(tree);
+            REQUIRE(copy != nullptr);
+            REQUIRE(std::memcmp(copy->nodes, tree->nodes, (tree->size + 1) * sizeof(IndexedNode)) == 0);
+            int extra = 10000;
+            REQUIRE(addToIndexedRBTree(copy, &extra));
+
+            THEN("the copy is a valid tree of its own, and the original didn't change") {
+                REQUIRE(checkIndexedSubtree(*copy, copy->root, INDEXED_NONE) > 0);
+                REQUIRE(copy->size == 10001);
+                REQUIRE(containsIndexedRBTree(copy, &extra));
+                REQUIRE(tree->size == 10000);
+                REQUIRE(!containsIndexedRBTree(tree, &extra));
+            }
+            freeIndexedRBTree(copy);
+            REQUIRE(freedCount == 0);
+        }
+
+        freeIndexedRBTree(tree);
+        REQUIRE(freedCount == 10000);
+    }
+}
+
+/**
+ * the functions of a read-only array layout of a tree, for checking the layouts against the same cases
+ */
+struct FrozenLayout {
+    static constexpr const char *name = "frozen";
+    static constexpr auto build = freezeRBTree;
+    static constexpr auto contains = containsFrozenRBTree;
+    static constexpr auto floor = floorFrozenRBTree;
+    static constexpr auto ceiling = ceilingFrozenRBTree;
+    static constexpr auto forEach = forEachFrozenRBTree;
+    static constexpr auto sizeOf = sizeOfFrozenRBTree;
+    static constexpr auto release = freeFrozenRBTree;
+};
+
+struct VebLayout {
+    static constexpr const char *name = "van Emde Boas";
+    static constexpr auto build = exportVebRBTree;
+    static constexpr auto contains = containsVebRBTree;
+    static constexpr auto floor = floorVebRBTree;
+    static constexpr auto ceiling = ceilingVebRBTree;
+    static constexpr auto forEach = forEachVebRBTree;
+    static constexpr auto sizeOf = sizeOfVebRBTree;
+    static constexpr auto release = freeVebRBTree;
+};
+
+template <typename Layout>
+static void checkArrayLayout(int n) {
+    GIVEN("A tree built via RBTree.h of the first " << n << " even numbers, and its " << Layout::name << " copy") {
+        std::vector<int> elements(n);
+        for (int i = 0; i < n; i++) {
+            elements[i] = 2 * i;
+        }
+        std::vector<int> shuffled(elements);
+        std::shuffle(shuffled.begin(), shuffled.end(), std::default_random_engine {});
+        RBTree *tree = newRBTree(compareInts, noFree);
+        for (auto &element: shuffled) {
+            REQUIRE(addToRBTree(tree, &element));
+        }
+        auto *copy = Layout::build(tree);
+        REQUIRE(copy != nullptr);
+
+        THEN("it holds the same items, in the same order") {
+            REQUIRE(Layout::sizeOf(copy) == n);
+            std::vector<int> items;
+            REQUIRE(Layout::forEach(copy, collectInts, &items));
+            REQUIRE(items == elements);
+        }
+
+        THEN("every probe gets the same answers from both") {
+            for (int probe = -1; probe <= 2 * n; probe++) {
+                CAPTURE(probe);
+                REQUIRE((Layout::contains(copy, &probe) != 0) == (containsRBTree(tree, &probe) != 0));
+                REQUIRE(Layout::floor(copy, &probe) == floorRBTree(tree, &probe));
+                REQUIRE(Layout::ceiling(copy, &probe) == ceilingRBTree(tree, &probe));
+            }
+        }
+
+        Layout::release(copy);
+        freeRBTree(tree);
+    }
+
+    GIVEN("A tree of " << n << " products compared with ids, and its " << Layout::name << " copy") {
+        std::vector<Product> products(n);
+        std::vector<void *> items;
+        for (int i = 0; i < n; i++) {
+            products[i] = Product { i * 0.5, 2 * i };
+            items.push_back(&products[i]);
+        }
+        RBTreeEx *tree = newRBTreeFromSorted(compareIdToProduct, nullptr, items.data(), items.size(), nullptr, 0);
+        auto *copy = Layout::build(&tree->base);
+        REQUIRE(copy != nullptr);
+
+        THEN("ids are looked up like in the tree") {
+            for (int id = -1; id <= 2 * n; id++) {
+                CAPTURE(id);
+                REQUIRE((Layout::contains(copy, &id) != 0) == (id >= 0 && id < 2 * n && id % 2 == 0));
+                REQUIRE(Layout::floor(copy, &id) == floorRBTree(&tree->base, &id));
+                REQUIRE(Layout::ceiling(copy, &id) == ceilingRBTree(&tree->base, &id));
+            }
+        }
+
+        Layout::release(copy);
+        freeRBTreeEx(tree);
+    }
+}
+
+SCENARIO("Frozen and van Emde Boas copies answer the same queries as the tree", "[extensions][frozen][veb]") {
+    auto n = GENERATE(0, 1, 2, 3, 4, 7, 8, 15, 16, 1000, 1025);
+    auto veb = GENERATE(0, 1);
+    if (veb) {
+        checkArrayLayout<VebLayout>(n);
+    } else {
+        checkArrayLayout<FrozenLayout>(n);
+    }
+}
+
+SCENARIO("B trees behave like RB trees", "[extensions][b tree]") {
+    auto fanout = GENERATE(0, 4, 5, 64);
+    GIVEN("A B tree with a fanout of " << fanout << ", of 10000 shuffled integers") {
+        std::vector<int> elements(10000);
+        std::iota(elements.begin(), elements.end(), 0);
+        std::vector<int> shuffled(elements);
+        std::shuffle(shuffled.begin(), shuffled.end(), std::default_random_engine {});
+        storedBegin = shuffled.data();
+        storedEnd = shuffled.data() + shuffled.size();
+        misorderedComparisons = 0;
+        freedCount = 0;
+        BTree *tree = newBTree(compareProbeToStored, countFree, fanout);
+        REQUIRE(tree != nullptr);
+        for (auto &element: shuffled) {
+            REQUIRE(addToBTree(tree, &element));
+        }
+
+        THEN("it holds every item once, in order") {
+            REQUIRE(!addToBTree(tree, &shuffled[42]));
+            REQUIRE(sizeOfBTree(tree) == 10000);
+            std::vector<int> items;
+            REQUIRE(forEachBTree(tree, collectInts, &items));
+            REQUIRE(items == elements);
+            for (int probe = -1; probe <= 10000; probe++) {
+                REQUIRE((containsBTree(tree, &probe) != 0) == (probe >= 0 && probe < 10000));
+            }
+            // the probe always goes first, and is only ever compared with stored items
+            REQUIRE(misorderedComparisons == 0);
+        }
+
+        THEN("the walk stops once the function fails") {
+            int count = 0;
+            REQUIRE(!forEachBTree(tree, [](const void *, void *args) {
+                return (int) (++*(int *) args < 3);
+            }, &count));
+            REQUIRE(count == 3);
+        }
+
+        freeBTree(tree);
+        REQUIRE(freedCount == 10000);
+    }
+
+    GIVEN("Fanouts too small for splitting a node") {
+        THEN("no tree is made") {
+            REQUIRE(newBTree(compareInts, nullptr, 3) == nullptr);
+            REQUIRE(newBTree(compareInts, nullptr, -1) == nullptr);
+        }
+    }
+}
+
+SCENARIO("Typed trees of C++ values", "[extensions][typed]") {
+    GIVEN("A rb::Tree of 10000 shuffled integers") {
+        std::vector<int> elements(10000);
+        std::iota(elements.begin(), elements.end(), 0);
+        std::vector<int> shuffled(elements);
+        std::shuffle(shuffled.begin(), shuffled.end(), std::default_random_engine {});
+        rb::Tree<int> tree;
+        for (int element: shuffled) {
+            REQUIRE(tree.insert(element).second);
+        }
+
+        THEN("it holds every item once, and iterates over them in both directions") {
+            auto duplicate = tree.insert(42);
+            REQUIRE(!duplicate.second);
+            REQUIRE(*duplicate.first == 42);
+            REQUIRE(tree.size() == 10000);
+            REQUIRE(std::vector<int>(tree.begin(), tree.end()) == elements);
+            std::vector<int> reversed(std::make_reverse_iterator(tree.end()), std::make_reverse_iterator(tree.begin()));
+            REQUIRE(std::equal(reversed.begin(), reversed.end(), elements.rbegin()));
+            REQUIRE(tree.contains(9999));
+            REQUIRE(!tree.contains(10000));
+            REQUIRE(tree.find(-1) == tree.end());
+            REQUIRE(*tree.lower_bound(-5) == 0);
+            REQUIRE(tree.lower_bound(10000) == tree.end());
+        }
+
+        THEN("copies are independent, and moving leaves the source empty") {
+            rb::Tree<int> copy(tree);
+            REQUIRE(copy.insert(10000).second);
+            REQUIRE(!tree.contains(10000));
+            REQUIRE(copy.size() == 10001);
+
+            rb::Tree<int> moved(std::move(tree));
+            REQUIRE(moved.size() == 10000);
+            REQUIRE(tree.empty());
+            REQUIRE(tree.begin() == tree.end());
+            tree = std::move(copy);
+            REQUIRE(tree.size() == 10001);
+            REQUIRE(*std::prev(tree.end()) == 10000);
+        }
+    }
+
+    GIVEN("A rb::Tree of strings, in descending order") {
+        rb::Tree<std::string, std::greater<std::string>> tree;
+        REQUIRE(tree.emplace(3, 'b').second);
+        REQUIRE(tree.emplace("a").second);
+        REQUIRE(tree.insert(std::string("c")).second);
+        REQUIRE(!tree.emplace("bbb").second);
+
+        THEN("they're kept in the given order") {
+            REQUIRE(std::vector<std::string>(tree.begin(), tree.end()) == std::vector<std::string> {"c", "bbb", "a"});
+        }
+    }
+}
+
+struct Point {
+    int x, y;
+};
+
+RBTREE_DEFINE(PointTree, Point, a.x != b.x ? RBTREE_COMPARE_NUMBERS(a.x, b.x) : RBTREE_COMPARE_NUMBERS(a.y, b.y))
+
+template <typename Key>
+static int collectKeys(const Key *key, void *args)
+{
+    ((std::vector<Key> *) args)->push_back(*key);
+    return 1;
+}
+
+/**
+ * Checks parent links, ordering and the RB properties of a subtree of a tree made by RBTREE_DEFINE
+ * @return black height of the subtree, or -1 if it's invalid
+ */
+template <typename NodeType>
+static int checkDefinedSubtree(const NodeType *node, const NodeType *parent)
+{
+    if (node == nullptr) {
+        return 1;
+    }
+    if (node->parent != parent || (node->color == RED && parent != nullptr && parent->color == RED)) {
+        return -1;
+    }
+    if ((node->left != nullptr && !(node->left->key < node->key)) ||
+        (node->right != nullptr && !(node->key < node->right->key))) {
+        return -1;
+    }
+    int left = checkDefinedSubtree(node->left, node);
+    int right = checkDefinedSubtree(node->right, node);
+    if (left < 0 || left != right) {
+        return -1;
+    }
+    return left + (node->color == BLACK);
+}
+
+SCENARIO("Trees generated for a key type", "[extensions][define]") {
+    GIVEN("An IntRBTree and a DoubleRBTree of 5000 shuffled keys") {
+        std::vector<int> keys(5000);
+        std::iota(keys.begin(), keys.end(), -2500);
+        std::vector<int> shuffled(keys);
+        std::shuffle(shuffled.begin(), shuffled.end(), std::default_random_engine {});
+        IntRBTree *ints = newIntRBTree();
+        DoubleRBTree *doubles = newDoubleRBTree();
+        for (int key: shuffled) {
+            REQUIRE(addToIntRBTree(ints, key));
+            REQUIRE(addToDoubleRBTree(doubles, key / 4.0));
+        }
+
+        THEN("they're valid RB trees, holding the keys themselves in order") {
+            REQUIRE(checkDefinedSubtree<IntRBTreeNode>(ints->root, nullptr) > 0);
+            REQUIRE(checkDefinedSubtree<DoubleRBTreeNode>(doubles->root, nullptr) > 0);
+            REQUIRE(ints->size == 5000);
+            REQUIRE(doubles->size == 5000);
+            std::vector<int> intKeys;
+            REQUIRE(forEachIntRBTree(ints, collectKeys<int>, &intKeys));
+            REQUIRE(intKeys == keys);
+            std::vector<double> doubleKeys;
+            REQUIRE(forEachDoubleRBTree(doubles, collectKeys<double>, &doubleKeys));
+            REQUIRE(doubleKeys.front() == -625.0);
+            REQUIRE(std::is_sorted(doubleKeys.begin(), doubleKeys.end()));
+        }
+
+        THEN("lookups and duplicates compare by value") {
+            REQUIRE(!addToIntRBTree(ints, 7));
+            REQUIRE(containsIntRBTree(ints, -2500));
+            REQUIRE(!containsIntRBTree(ints, 2500));
+            REQUIRE(containsDoubleRBTree(doubles, 0.25));
+            REQUIRE(!containsDoubleRBTree(doubles, 0.3));
+            REQUIRE(!addToDoubleRBTree(doubles, 0.5));
+        }
+
+        freeIntRBTree(ints);
+        freeDoubleRBTree(doubles);
+    }
+
+    GIVEN("A tree of structs with a comparison over two fields") {
+        PointTree *points = newPointTree();
+        REQUIRE(addToPointTree(points, Point {1, 2}));
+        REQUIRE(addToPointTree(points, Point {0, 5}));
+        REQUIRE(addToPointTree(points, Point {1, 1}));
+        REQUIRE(!addToPointTree(points, Point {0, 5}));
+
+        THEN("it orders them by the expression") {
+            std::vector<Point> items;
+            REQUIRE(forEachPointTree(points, collectKeys<Point>, &items));
+            REQUIRE(items.size() == 3);
+            REQUIRE((items[0].x == 0 && items[1].y == 1 && items[2].y == 2));
+            REQUIRE(containsPointTree(points, Point {1, 1}));
+            REQUIRE(!containsPointTree(points, Point {1, 3}));
+        }
+        freePointTree(points);
+    }
+}
+
+struct Record {
+    int key;
+    Node hook;
+};
+
+static int compareRecords(const void *a, const void *b) {
+    return countingCompareInts(&((const Record *) a)->key, &((const Record *) b)->key);
+}
+
+static void deleteRecord(void *record) {
+    freedCount++;
+    delete (Record *) record;
+}
+
+SCENARIO("Intrusive trees link the nodes embedded in their items", "[extensions][intrusive]") {
+    GIVEN("An intrusive tree of 5000 shuffled records") {
+        std::vector<int> keys(5000);
+        std::iota(keys.begin(), keys.end(), 0);
+        auto rng = std::default_random_engine {};
+        std::shuffle(keys.begin(), keys.end(), rng);
+        RBTreeConfig config = { 0, 0, 0, 1, offsetof(Record, hook) };
+        RBTreeEx *tree = newRBTreeEx(compareRecords, deleteRecord, &config);
+        REQUIRE(tree != nullptr);
+        std::vector<Record *> records;
+        for (int key: keys) {
+            records.push_back(new Record { key, {} });
+            REQUIRE(addToRBTreeEx(tree, records.back()));
+        }
+        freedCount = 0;
+
+        THEN("every node is the hook of its own item") {
+            REQUIRE(isValidRBTree(tree->base));
+            REQUIRE(tree->base.size == 5000);
+            for (Record *record: records) {
+                REQUIRE(record->hook.data == record);
+            }
+            Record probe { 4999, {} };
+            REQUIRE(containsRBTree(&tree->base, &probe));
+            REQUIRE(!addToRBTreeEx(tree, &probe));
+        }
+
+        WHEN("removing and freeing half of the records, and adding a batch of new ones") {
+            for (size_t i = 0; i < records.size(); i += 2) {
+                Record probe { records[i]->key, {} };
+                REQUIRE(removeFromRBTree(tree, &probe, 1));
+            }
+            std::vector<void *> batch;
+            for (int key = 5000; key < 6000; key++) {
+                batch.push_back(new Record { key, {} });
+            }
+            REQUIRE(addManyToRBTree(tree, batch.data(), batch.size(), nullptr));
+
+            THEN("the tree is still valid, and holds the right records") {
+                REQUIRE(freedCount == 2500);
+                REQUIRE(isValidRBTree(tree->base));
+                REQUIRE(tree->base.size == 3500);
+                for (size_t i = 1; i < records.size(); i += 2) {
+                    REQUIRE(containsRBTree(&tree->base, records[i]));
+                }
+                REQUIRE(((Record *) batch[999])->hook.data == batch[999]);
+            }
+        }
+
+        int expectedFreed = freedCount + tree->base.size;
+        freeRBTreeEx(tree);
+        REQUIRE(freedCount == expectedFreed);
+    }
+
+    GIVEN("Options that need nodes of the tree's own") {
+        RBTreeConfig withArena = { 1, 0, 0, 1, offsetof(Record, hook) };
+        RBTreeConfig counted = { 0, 0, 1, 1, offsetof(Record, hook) };
+        THEN("they can't be combined with an intrusive tree") {
+            REQUIRE(newRBTreeEx(compareRecords, nullptr, &withArena) == nullptr);
+            REQUIRE(newRBTreeEx(compareRecords, nullptr, &counted) == nullptr);
+        }
+    }
+}
+
+SCENARIO("Adding an item or finding the one that's already there", "[extensions][upsert]") {
+    GIVEN("A tree of 1000 records with even keys") {
+        auto intrusive = GENERATE(0, 1);
+        CAPTURE(intrusive);
+        RBTreeConfig config = { 0, 0, 0, intrusive, offsetof(Record, hook) };
+        RBTreeEx *tree = newRBTreeEx(compareRecords, deleteRecord, &config);
+        std::vector<Record *> records;
+        for (int key = 0; key < 2000; key += 2) {
+            records.push_back(new Record { key, {} });
+            REQUIRE(addToRBTreeEx(tree, records.back()));
+        }
+        freedCount = 0;
+
+        WHEN("looking up or adding records, in a single descent each") {
+            Record *added = new Record { 501, {} };
+            Record duplicate { 500, {} };
+            void *existing = &duplicate;
+            comparisons = 0;
+            REQUIRE(findOrAddRBTree(tree, added, &existing));
+            REQUIRE(existing == nullptr);
+            REQUIRE(findOrAddRBTree(tree, &duplicate, &existing));
+            REQUIRE(existing == records[250]);
+            // a RB tree of 1001 nodes is at most 2 * log(1002) ~ 20 levels deep
+            REQUIRE(comparisons <= 2 * 20);
+
+            THEN("only the missing record was added") {
+                REQUIRE(isValidRBTree(tree->base));
+                REQUIRE(tree->base.size == 1001);
+                REQUIRE(ceilingRBTree(&tree->base, added) == added);
+                REQUIRE(ceilingRBTree(&tree->base, &duplicate) == records[250]);
+                REQUIRE(freedCount == 0);
+            }
+        }
+
+        WHEN("replacing records by equal ones") {
+            Record *freed = new Record { 500, {} };
+            Record *kept = new Record { 700, {} };
+            Record *added = new Record { 501, {} };
+            void *replaced = nullptr;
+            REQUIRE(addOrReplaceRBTree(tree, freed, 1, &replaced));
+            REQUIRE(replaced == records[250]);
+            REQUIRE(freedCount == 1);
+            REQUIRE(addOrReplaceRBTree(tree, kept, 0, &replaced));
+            REQUIRE(replaced == records[350]);
+            REQUIRE(addOrReplaceRBTree(tree, added, 1, &replaced));
+            REQUIRE(replaced == nullptr);
+            REQUIRE(addOrReplaceRBTree(tree, added, 1, &replaced));
+            REQUIRE(replaced == nullptr);
+            REQUIRE(freedCount == 1);
+            delete records[350];
+
+            THEN("the new records are stored in place of the old ones") {
+                REQUIRE(isValidRBTree(tree->base));
+                REQUIRE(tree->base.size == 1001);
+                REQUIRE(ceilingRBTree(&tree->base, freed) == freed);
+                REQUIRE(ceilingRBTree(&tree->base, kept) == kept);
+                REQUIRE(ceilingRBTree(&tree->base, added) == added);
+                if (intrusive) {
+                    REQUIRE(freed->hook.data == freed);
+                    REQUIRE(kept->hook.data == kept);
+                }
+                std::vector<int> keys;
+                RBIterator it;
+                for (void *item = firstRBTree(&tree->base, &it); item != nullptr; item = nextRBTree(&it)) {
+                    keys.push_back(((Record *) item)->key);
+                }
+                REQUIRE(std::is_sorted(keys.begin(), keys.end()));
+                REQUIRE(keys.size() == 1001);
+            }
+        }
+
+        int expectedFreed = freedCount + tree->base.size;
+        freeRBTreeEx(tree);
+        REQUIRE(freedCount == expectedFreed);
+    }
+}